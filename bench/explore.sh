@@ -0,0 +1,88 @@
+#!/bin/sh
+# End-to-end exploration benchmark: runs fixed explore workloads, writes
+# their time, states/sec and peak RSS to bench/explore-results.txt and fails
+# when any of them is worse than bench/explore-baseline.txt by more than
+# TOLERANCE percent.  Run with --update to accept the results as the baseline.
+#
+# Times and rates are compared in units of a reference run timed on the
+# same machine in the same invocation (starting processes and a fixed awk
+# loop, which is what the workloads spend their time on), so a baseline
+# made on one machine holds on another; RSS is compared as it is.
+
+TOLERANCE=${TOLERANCE:-25}
+RESULTS=bench/explore-results.txt
+BASELINE=bench/explore-baseline.txt
+
+cd "$(dirname "$0")/.." || exit 1
+
+workload() {
+	name=$1
+	shift
+	line=$(./explore -r "$@" | tail -n 1)
+	case $line in
+	time=*)	echo "$name $line" ;;
+	*)	echo "$0: workload $name failed" >&2; exit 1 ;;
+	esac
+}
+
+# the fastest of three runs, in seconds
+reference() {
+	best=
+	for run in 1 2 3; do
+		start=$(date +%s.%N)
+		i=0
+		while [ $i -lt 1000 ]; do
+			/bin/true
+			i=$((i + 1))
+		done
+		awk 'BEGIN { for (i = 0; i < 2000000; i++) s += i * i }'
+		end=$(date +%s.%N)
+		best=$(echo "$start $end $best" | awk '{ t = $2 - $1; print ($3 == "" || t < $3) ? t : $3 }')
+	done
+	echo "reference time=$best"
+}
+
+{
+	reference
+	workload shallow -n 4
+	workload deep -n 10
+	workload seeded -w bench/seeds.txt -n 2
+	workload replay -t < bench/corpus.txt
+} > $RESULTS || exit 1
+cat $RESULTS
+
+if [ "$1" = "--update" ]; then
+	cp $RESULTS $BASELINE
+	exit 0
+fi
+
+# time and rss must not grow, rate must not drop; time and rate relative to
+# each file's reference
+awk -v tol=$TOLERANCE '
+	function field(line, key,    i, n, kv) {
+		n = split(line, kv, /[ =]/)
+		for (i = 2; i < n; i += 2)
+			if (kv[i] == key)
+				return kv[i+1]
+		return ""
+	}
+	function check(name, key, base, now, worse) {
+		if (base == "" || now == "")
+			return
+		if (worse > tol) {
+			printf "%s: %s regressed %.1f%% (%s -> %s)\n", name, key, worse, base, now
+			failed = 1
+		}
+	}
+	BEGIN { scale = 1 }
+	NR == FNR { baseline[$1] = $0; next }
+	$1 == "reference" && "reference" in baseline { scale = field(baseline["reference"], "time") / field($0, "time"); next }
+	$1 in baseline {
+		b = baseline[$1]
+		check($1, "time", field(b, "time"), field($0, "time"), 100 * (scale * field($0, "time") / field(b, "time") - 1))
+		check($1, "rate", field(b, "rate"), field($0, "rate"), 100 * (1 - field($0, "rate") / (scale * field(b, "rate"))))
+		check($1, "rss", field(b, "rss"), field($0, "rss"), 100 * (field($0, "rss") / field(b, "rss") - 1))
+	}
+	END { exit failed }
+' $BASELINE $RESULTS || exit 1
+echo "no regressions beyond $TOLERANCE%"
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <fstream>
 #include <cstdio>
 #include <cstdlib>
 #include <cassert>
@@ -7,6 +8,7 @@
 #include <signal.h>
 #include <errno.h>
 #include <sys/wait.h>
+#include <sys/resource.h>
 #include <string>
 #include <map>
 #include <set>
@@ -14,6 +16,9 @@
 #include <vector>
 #include <algorithm>
 #include <regex>
+#include <chrono>
+#include <memory_resource>
+#include <new>
 using std::string;
 using std::string_view;
 using std::map;
@@ -23,6 +28,52 @@ using std::vector;
 using std::pair;
 using std::regex;
 using std::ranges::count;
+using pstring = std::pmr::string;
+
+// heap traffic: long-lived containers draw their nodes from the pool (made the
+// default resource in main), per-run scratch strings come from the arena,
+// which is released before every run
+size_t allocations;     // calls to operator new, for the telemetry
+std::pmr::unsynchronized_pool_resource pool;
+char arena_buffer[1<<20];
+std::pmr::monotonic_buffer_resource arena{arena_buffer,sizeof(arena_buffer)};
+
+void *operator new(size_t size)
+{
+    allocations++;
+    if (void *p = malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p,size_t) noexcept
+{
+    free(p);
+}
+
+// regex match state in the per-run arena
+using pmatch = std::match_results<pstring::const_iterator,
+                                  std::pmr::polymorphic_allocator<std::sub_match<pstring::const_iterator>>>;
+
+bool search(const pstring &s,const regex &re)
+{
+    pmatch m(&arena);
+    return std::regex_search(s.begin(),s.end(),m,re);
+}
+
+// concatenation in the per-run arena
+pstring join(string_view a,string_view b)
+{
+    pstring s(&arena);
+    s.reserve(a.length()+b.length());
+    s.append(a).append(b);
+    return s;
+}
 
 void die(const char *msg)
 {
@@ -30,17 +81,18 @@ void die(const char *msg)
     exit(1);
 }
 
-string exchange(int in,int out,string msg,int extra=0)
+// write msg to game input, false if the game is gone
+bool send(int in,string_view msg)
 {
     assert(msg=="" || msg.back()=='\n');
+    return write(in,msg.data(),msg.length()) == (int)msg.length();
+}
 
-    // write msg to game input (inpipe[1])
-    if (write(in,msg.c_str(),msg.length()) != (int)msg.length())
-        return "";
-
-    // poll for data until the prompt shows up, or EOF
-    const string prompt = "\ncommand> ";
-    string response;
+// poll game output for data until the prompt shows up, or EOF
+pstring receive(int out,int extra=0)
+{
+    const string_view prompt = "\ncommand> ";
+    pstring response(&arena);
     int loops = 0;
     while (1) {
         char buf[4096];
@@ -54,23 +106,34 @@ string exchange(int in,int out,string msg,int extra=0)
         if (loops >= extra) {
             if (len == 0)
                 return response;
-            if (response.ends_with(prompt))
-                return response.substr(0,response.length()-prompt.length());
+            if (response.ends_with(prompt)) {
+                response.resize(response.length()-prompt.length());
+                return response;
+            }
         }
         usleep(1000); // 0.001 seconds
     }
 }
 
 struct outcome_t {
-    string      response;   // response to last command
-    string      state;      // game state (where & what)
+    pstring     response;   // response to last command
+    pstring     state;      // game state (where & what)
+
+    auto operator<=>(const outcome_t &) const = default;
 };
 
-outcome_t run(string setup,string command)
-{
-    assert(setup=="" || setup.back()=='\n');
-    assert(command.back()=='\n');
+struct game_t {
+    pid_t   pid;
+    int     in;         // game input (inpipe[1])
+    int     out;        // game output (outpipe[0])
+    bool    alive;      // accepted the last input
+};
+
+vector<string> games{"forest"};   // game binaries to run in lockstep
+int runs;                           // game processes launched
 
+game_t launch(const string &binary)
+{
     int inpipe[2];
     int outpipe[2];
     if (pipe(inpipe) || pipe(outpipe)) die("pipe creation failed");
@@ -80,32 +143,11 @@ outcome_t run(string setup,string command)
     fcntl(outpipe[0],F_SETPIPE_SZ,1024*1024);
     if (fcntl(outpipe[0], F_SETFL, O_NONBLOCK) < 0) die("set nonblocking failed");
 
-    outcome_t r;
-    string items;
+    runs++;
     pid_t pid = fork();
     if (pid < 0)
         die("fork failed");
-    else if (pid > 0) {
-        close(inpipe[0]);
-        close(outpipe[1]);
-        // parent:
-
-        // write setup commands to game input and ignore results
-        exchange(inpipe[1],outpipe[0],setup,2);
-
-        // write new command to game
-        r.response = exchange(inpipe[1],outpipe[0],command);
-
-        // write look/inv commands to game (to get current location)
-        r.state = exchange(inpipe[1],outpipe[0],"look\ninv\n");
-
-        // we're done
-        close(inpipe[1]);
-        close(outpipe[0]);
-        kill(pid,SIGKILL); // could send a 'q' command?
-        waitpid(pid,NULL,0);
-    }
-    else {
+    else if (pid == 0) {
         // child:
         // read from inpipe[0]
         // write to outpipe[1]
@@ -114,10 +156,60 @@ outcome_t run(string setup,string command)
         close(inpipe[0]);
         close(outpipe[0]);
         close(outpipe[1]);
-        execl("forest","forest",NULL);
+        execl(binary.c_str(),binary.c_str(),NULL);
         die("exec failed");
     }
 
+    // parent:
+    close(inpipe[0]);
+    close(outpipe[1]);
+    return {pid,inpipe[1],outpipe[0],true};
+}
+
+void finish(game_t &g)
+{
+    close(g.in);
+    close(g.out);
+    kill(g.pid,SIGKILL); // could send a 'q' command?
+    waitpid(g.pid,NULL,0);
+}
+
+// run setup and command in every game binary, one outcome per binary
+std::pmr::vector<outcome_t> run(string_view setup,string_view command)
+{
+    assert(setup=="" || setup.back()=='\n');
+    assert(command.back()=='\n');
+
+    // every message goes to all games before any response is collected,
+    // so the games do their work side by side
+    std::pmr::vector<game_t> g(&arena);
+    for (auto const &binary:games)
+        g.push_back(launch(binary));
+
+    // write setup commands to game input and ignore results
+    for (auto &x:g)
+        x.alive = send(x.in,setup);
+    for (auto &x:g)
+        if (x.alive)
+            receive(x.out,2);
+
+    // write new command to game
+    std::pmr::vector<outcome_t> r(&arena);
+    for (auto &x:g)
+        x.alive = send(x.in,command);
+    for (auto &x:g)
+        r.push_back({x.alive ? receive(x.out) : pstring(&arena),pstring(&arena)});
+
+    // write look/inv commands to game (to get current location)
+    for (auto &x:g)
+        x.alive = send(x.in,"look\ninv\n");
+    for (size_t i=0; i<g.size(); i++)
+        if (g[i].alive)
+            r[i].state = receive(g[i].out);
+
+    // we're done
+    for (auto &x:g)
+        finish(x);
     return r;
 }
 
@@ -199,22 +291,108 @@ vector<pattern_t> patterns{
 // TODO add initial item locations tracking
 // TODO add "look ITEM" description
 
-string pipes(string s)
+pstring pipes(string_view s,std::pmr::memory_resource *mr=std::pmr::get_default_resource())
 {
-    std::ranges::replace(s,'\n','|');
-    return s;
+    pstring r(s,mr);
+    std::ranges::replace(r,'\n','|');
+    return r;
 }
 
-string newlines(string s)
+pstring newlines(string_view s,std::pmr::memory_resource *mr=std::pmr::get_default_resource())
 {
-    std::ranges::replace(s,'|','\n');
-    return s;
+    pstring r(s,mr);
+    std::ranges::replace(r,'|','\n');
+    return r;
 }
 
-map<string,string> results;     // command sequence ==> recognition pattern
-map<string,string> unknowns;    // command sequence ==> response
-set<string> visited;            // game states (where & what)
-queue<string> todo;             // command sequences to explore
+struct node_t {
+    pstring                     path;       // shortest command sequence reaching this state
+    int                         depth;      // commands used beyond the seed path
+    bool                        expanded;   // every command has been tried from here
+    std::pmr::vector<int>       next;       // command index ==> resulting game state
+    std::pmr::vector<pstring>   responses;  // command index ==> response
+};
+
+std::pmr::map<pstring,pstring> results{&pool};  // command sequence ==> recognition pattern
+std::pmr::map<pstring,pstring> unknowns{&pool}; // command sequence ==> response
+std::pmr::map<pstring,int> visited{&pool};      // game states (where & what) ==> graph node
+std::pmr::map<pair<outcome_t,outcome_t>,pstring> divergences{&pool};  // (old,new) outcomes ==> shortest path
+std::pmr::vector<node_t> graph{&pool};          // discovered state graph, node 0 is the start
+queue<int> todo;                // graph nodes to explore
+
+// partition the state graph into bisimulation classes (Hopcroft's algorithm):
+// two states share a class when every command sequence from them produces the
+// same responses; states that were never expanded are kept in classes of their own
+vector<int> minimize()
+{
+    int n = graph.size();
+    int m = cmds.size();
+    vector<int> block(n);
+    vector<vector<int>> members;
+
+    // initial partition: expanded states by their responses
+    map<std::pmr::vector<pstring>,int> initial;
+    for (int s=0; s<n; s++) {
+        if (graph[s].expanded) {
+            auto [it,fresh] = initial.insert({graph[s].responses,(int)members.size()});
+            if (fresh)
+                members.push_back({});
+            block[s] = it->second;
+        }
+        else {
+            block[s] = members.size();
+            members.push_back({});
+        }
+        members[block[s]].push_back(s);
+    }
+
+    // pred[c][t] = states that reach t with command c
+    vector<vector<vector<int>>> pred(m,vector<vector<int>>(n));
+    for (int s=0; s<n; s++)
+        if (graph[s].expanded)
+            for (int c=0; c<m; c++)
+                pred[c][graph[s].next[c]].push_back(s);
+
+    set<pair<int,int>> splitters;   // (block,command) pairs still to split by
+    for (int b=0; b<(int)members.size(); b++)
+        for (int c=0; c<m; c++)
+            splitters.insert({b,c});
+
+    while (!splitters.empty()) {
+        auto [b,c] = *splitters.begin();
+        splitters.erase(splitters.begin());
+
+        // states whose command c leads into block b, grouped by their own block
+        map<int,vector<int>> hit;
+        for (int t:members[b])
+            for (int s:pred[c][t])
+                hit[block[s]].push_back(s);
+
+        for (auto &[x,xs]:hit) {
+            if (xs.size() == members[x].size())
+                continue;
+            int y = members.size();
+            members.push_back(xs);
+            for (int s:xs)
+                block[s] = y;
+            std::erase_if(members[x],[&](int s){ return block[s] == y; });
+            for (int d=0; d<m; d++) {
+                if (splitters.contains({x,d}))
+                    splitters.insert({y,d});
+                else if (members[x].size() <= members[y].size())
+                    splitters.insert({x,d});
+                else
+                    splitters.insert({y,d});
+            }
+        }
+    }
+
+    // number the classes in order of discovery
+    map<int,int> renumber;
+    for (auto &b:block)
+        b = renumber.insert({b,(int)renumber.size()}).first->second;
+    return block;
+}
 
 int main(int argc,char *argv[])
 {
@@ -225,7 +403,10 @@ int main(int argc,char *argv[])
     bool print_paths        = false;
     bool print_unknowns     = false;
     bool print_stats        = false;
+    bool print_classes      = false;
+    bool print_resources    = false;
     bool test_paths         = false;
+    string seeds;
     int depth = 100;
 
     for (int i=1; i<argc; i++) {
@@ -240,6 +421,22 @@ int main(int argc,char *argv[])
                 i++;
             }
         }
+        else if (arg == "-w") {
+            if (i == argc-1)
+                help = true;
+            else {
+                seeds = argv[i+1];
+                i++;
+            }
+        }
+        else if (arg == "--diff") {
+            if (i+2 >= argc)
+                help = true;
+            else {
+                games = {argv[i+1],argv[i+2]};
+                i += 2;
+            }
+        }
         else if (arg == "-h")
             help = true;
         else if (arg == "-l")
@@ -252,6 +449,10 @@ int main(int argc,char *argv[])
             print_unknowns = true;
         else if (arg == "-s")
             print_stats = true;
+        else if (arg == "-m")
+            print_classes = true;
+        else if (arg == "-r")
+            print_resources = true;
         else if (arg == "-t")
             test_paths = true;
         else
@@ -263,42 +464,63 @@ int main(int argc,char *argv[])
     &&  !print_unknowns
     &&  !print_paths
     &&  !print_stats
+    &&  !print_classes
+    &&  !print_resources
     &&  !test_paths
-    &&  !verbose)
+    &&  !verbose
+    &&  games.size() < 2)
         help = true;
 
-    if (test_paths && (print_locations || print_paths || print_stats || print_unknowns))
+    if (test_paths && (print_locations || print_paths || print_stats || print_unknowns || print_classes || !seeds.empty() || games.size() > 1))
         die("incompatible options\n");
 
     if (help) {
         std::cout << "usage explore -t|[options]\n"
+                     "  --diff a b  explore game binaries a and b in lockstep, print divergences\n"
                      "  -h     print this help message, stop\n"
                      "  -v     be verbose, trace execution\n"
-                     "  -n #   maximum number of commands to use\n"
+                     "  -n #   maximum number of commands to use (beyond the seeds)\n"
+                     "  -w f   warm-start from the paths in file f (e.g. -p output)\n"
                      "  -l     print unique locations discovered\n"
                      //"  -i     print items discovered\n"
                      "  -p     print successful paths discovered\n"
                      "  -u     print paths with unknown responses\n"
                      "  -s     print statistics\n"
+                     "  -m     print bisimulation classes of game states\n"
+                     "  -r     print time, states/sec and peak memory on one line\n"
                      "  -t     test enumerated paths from stdin";
         exit(1);
     }
 
     signal(SIGPIPE, SIG_IGN);
+    std::pmr::set_default_resource(&pool);
     
     for (auto &r:patterns)
         r.re = r.pattern;
 
+    auto start = std::chrono::steady_clock::now();
+    size_t tested = 0;
+
     if (test_paths) {
         string cmds,pattern;
         while (getline(std::cin,cmds) && getline(std::cin,pattern)) {
+            tested++;
+            arena.release();
             auto i=cmds.rfind('|',cmds.length()-2);
-            auto setup = cmds.substr(0,i+1);
-            auto cmd = cmds.substr(i+1);
+            auto setup = string_view(cmds).substr(0,i+1);
+            auto cmd = string_view(cmds).substr(i+1);
             if (verbose)
                 std::cout << setup << " " << cmd << "\n" << pattern << "\n";
-            auto r = run(newlines(setup),newlines(cmd));
-            if (!std::regex_search(r.response,regex{pattern})) {
+            auto rs = run(newlines(setup,&arena),newlines(cmd,&arena));
+            auto const &r = rs[0];
+
+            // reuse the compiled regex of known patterns
+            regex adhoc;
+            auto known = std::ranges::find(patterns,pattern,&pattern_t::pattern);
+            if (known == patterns.end())
+                adhoc = pattern;
+            auto const &re = known != patterns.end() ? known->re : adhoc;
+            if (!search(r.response,re)) {
                 std::cout << setup << " " << cmd << " produced " << r.response << pattern << " was expected\n\n";
                 exit(1);
             }
@@ -306,43 +528,99 @@ int main(int argc,char *argv[])
     }
     else {
         // go exploring
-        todo.push("");
+        if (seeds.empty()) {
+            // the start state, so that returning to it is recognized
+            auto rs = run("","look\n");
+            graph.push_back({""});
+            if (rs.size() > 1 && rs[1] != rs[0])
+                // the games differ before any command: nothing to explore
+                divergences.try_emplace({rs[0],rs[1]},"");
+            else {
+                visited.try_emplace(rs[0].state,0);
+                todo.push(0);
+            }
+        }
+        else {
+            // start from the end of every seed path instead
+            std::ifstream in(seeds);
+            if (!in)
+                die("cannot read seed file");
+            string line;
+            while (getline(in,line)) {
+                // -p output interleaves patterns, paths are the lines ending in '|'
+                if (line.empty() || line.back() != '|')
+                    continue;
+                arena.release();
+                auto i = line.rfind('|',line.length()-2);
+                auto setup = newlines(string_view(line).substr(0,i+1),&arena);
+                auto cmd = newlines(string_view(line).substr(i+1),&arena);
+                auto rs = run(setup,cmd);
+                auto path = join(setup,cmd);
+                if (rs.size() > 1 && rs[1] != rs[0]) {
+                    // the games diverge along the seed: don't explore from there
+                    divergences.try_emplace({rs[0],rs[1]},path);
+                    continue;
+                }
+                auto [it,fresh] = visited.try_emplace(rs[0].state,(int)graph.size());
+                if (fresh) {
+                    graph.push_back({pstring(path,&pool)});  // outlives the arena
+                    todo.push(it->second);
+                }
+            }
+        }
         while (!todo.empty()) {
-            auto setup = todo.front(); todo.pop();
+            int from = todo.front(); todo.pop();
+            auto setup = graph[from].path;
+            graph[from].expanded = true;
             if (verbose)
                 std::cout << "sequence length: " << count(setup,'\n') << " , queue size: " << todo.size() << std::endl;
 
             for (auto &c:cmds) {
-                auto newcmd = c.cmd+"\n";
-                auto r = run(setup,newcmd);
+                arena.release();
+                auto newcmd = join(c.cmd,"\n");
+                auto rs = run(setup,newcmd);
+                auto const &r = rs[0];
                 //if (verbose)
                 //    std::cout << semicolons(newcmd) << "----\n" << r.response << "====\n";
 
-                auto cmds = setup+newcmd;
+                auto cmds = join(setup,newcmd);
                 pattern_t * p = nullptr;
                 for (size_t i=0; !p && i<patterns.size(); i++)
-                    if (std::regex_search(r.response,patterns[i].re))
+                    if (search(r.response,patterns[i].re))
                         p = &patterns[i];
 
                 if (p) {
-                    results.insert({cmds,p->pattern});
+                    results.try_emplace(cmds,p->pattern);
                     p->used++;
                     if (!p->stop)
                         c.used++;
                 }
                 else
-                    unknowns.insert({cmds,r.response});
+                    unknowns.try_emplace(cmds,r.response);
 
-                if (!visited.contains(r.state)) {
-                    visited.insert(r.state);
-                    if (p && !p->stop && count(cmds,'\n') < depth)
-                        todo.push(cmds);
+                int to = graph.size();
+                if (rs.size() > 1 && rs[1] != r) {
+                    // the games diverge: remember the shortest path, but don't descend
+                    divergences.try_emplace({r,rs[1]},cmds);
+                    graph.push_back({cmds,graph[from].depth+1});
+                }
+                else {
+                    auto [it,fresh] = visited.try_emplace(r.state,to);
+                    if (fresh) {
+                        graph.push_back({cmds,graph[from].depth+1});
+                        if (p && !p->stop && graph[from].depth+1 < depth)
+                            todo.push(to);
+                    }
+                    to = it->second;
                 }
+                graph[from].next.push_back(to);
+                graph[from].responses.push_back(r.response);
             }
         }
     }
     if (verbose)
         std::cout << std::endl << std::endl;
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
 
     // create summaries
 
@@ -352,10 +630,15 @@ int main(int argc,char *argv[])
     //         items.insert(y);
     // regex: Inventory:\n \t item \n \t ...
 
-    map<string,int> locations;
-    for (auto const &s:visited)
+    map<string_view,int> locations;
+    for (auto const &[s,id]:visited)
         if (s.length() > 0)
-            locations[s.substr(1,s.find('\n',2)-1)]++;  // fmt: \nPlace Name\n
+            locations[string_view(s).substr(1,s.find('\n',2)-1)]++;  // fmt: \nPlace Name\n
+
+    vector<int> classes;
+    if (print_classes || print_stats)
+        classes = minimize();
+    int class_count = classes.empty() ? 0 : std::ranges::max(classes)+1;
 
     // reports 
 
@@ -371,6 +654,22 @@ int main(int argc,char *argv[])
             std::cout << pipes(x.first) << "\n" << x.second << "\n";
     }
 
+    if (games.size() > 1) {
+        // shortest paths first
+        vector<pair<string_view,const pair<outcome_t,outcome_t> *>> order;
+        for (auto const &[d,path]:divergences)
+            order.push_back({path,&d});
+        std::ranges::sort(order,{},[](auto const &x){ return pair{count(x.first,'\n'),x.first}; });
+        for (auto const &[path,dp]:order) {
+            auto const &d = *dp;
+            std::cout << (path.empty() ? "(start)" : pipes(path)) << "\n";
+            if (d.first.response != d.second.response)
+                std::cout << "< " << pipes(d.first.response) << "\n> " << pipes(d.second.response) << "\n";
+            if (d.first.state != d.second.state)
+                std::cout << "< " << pipes(d.first.state) << "\n> " << pipes(d.second.state) << "\n";
+        }
+    }
+
     if (print_locations) {
         for (auto const &x:locations)
             std::cout << x.second << " " << x.first << "\n";
@@ -381,6 +680,15 @@ int main(int argc,char *argv[])
             std::cout << pipes(x.first) << "\n" << pipes(x.second) << "\n";
     }
 
+    if (print_classes) {
+        vector<pair<int,int>> order;    // (class,node)
+        for (size_t i=0; i<classes.size(); i++)
+            order.push_back({classes[i],i});
+        std::ranges::sort(order);
+        for (auto const &[k,i]:order)
+            std::cout << k << " " << pipes(graph[i].path) << "\n";
+    }
+
     // consider game states (locations + item sets)
 
     if (print_stats) {
@@ -389,7 +697,11 @@ int main(int argc,char *argv[])
         std::cout << "discovered paths: "   << results.size() << std::endl;
         std::cout << "locations: "          << locations.size() << std::endl;
         std::cout << "game states: "        << visited.size() << std::endl;
+        std::cout << "bisimulation classes: " << class_count << std::endl;
         std::cout << "unknown responses: "  << unknowns.size() << std::endl;
+        std::cout << "heap allocations: "   << allocations << std::endl;
+        if (games.size() > 1)
+            std::cout << "divergences: "    << divergences.size() << std::endl;
         std::cout << "\ncommand usage:\n";
         for (auto const &x:cmds)
             std::cout << "  " << x.used << " " << x.cmd << "\n";
@@ -397,4 +709,20 @@ int main(int argc,char *argv[])
         for (auto const &x:patterns)
             std::cout << "  " << x.used << " " << x.pattern << "\n";
     }
+
+    if (print_resources) {
+        // replayed paths stand in for states when testing
+        size_t states = test_paths ? tested : visited.size();
+        struct rusage usage;
+        getrusage(RUSAGE_SELF,&usage);
+        std::cout << "time=" << elapsed.count()
+                  << " states=" << states
+                  << " rate=" << states/elapsed.count()
+                  << " runs=" << runs
+                  << " allocs=" << allocations
+                  << " rss=" << usage.ru_maxrss << "\n";
+    }
+
+    // differential runs fail when the games disagree
+    return divergences.empty() ? 0 : 1;
 }
@@ -0,0 +1,118 @@
+#ifndef FOREST_H
+#define FOREST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Where a game's responses go. Zeroed, it is a memory sink: responses are
+ * appended to text, grown as needed and always NUL-terminated, until the
+ * caller resets len. An fd sink collects each response the same way and
+ * writes it to fd at the end of game_step(), followed by the prompt while
+ * the game goes on, in a single writev. A null sink drops everything
+ * without formatting it. The caller frees text when done with it.
+ */
+enum { OUTPUT_MEMORY, OUTPUT_FD, OUTPUT_NULL };
+
+struct game_output {
+	char *text;
+	size_t len;
+	size_t size;
+	int sink;		/* OUTPUT_MEMORY, OUTPUT_FD or OUTPUT_NULL */
+	int fd;
+	const char *prompt;	/* or NULL */
+	int framed;		/* write responses as frames, see below */
+	int error;		/* errno of a failed write, 0 if none */
+};
+
+/* A framed fd sink writes each response as a header of GAME_FRAME_HEADER
+ * characters followed by the text, so a reader knows where it ends:
+ *	"%08x %c %2d %10d %016llx\n"
+ * the length of the text in hex, the response class as a letter of
+ * GAME_FRAME_CLASSES, the game status, the room and the state hash.
+ */
+#define GAME_FRAME_HEADER 42
+#define GAME_FRAME_CLASSES "NUSCE"
+
+/* what the last command did: nothing (an empty line, or the game was
+ * already over), not understood, left the state as it was, changed it, or
+ * ended the game */
+enum { RESPONSE_NONE, RESPONSE_UNKNOWN, RESPONSE_SAME, RESPONSE_CHANGED, RESPONSE_ENDED };
+
+/* one independent game; any number of them can run in a process */
+struct game;
+
+/* a world image written by worldc, mapped read-only and shared by the
+ * games played in it; unload it after the last of them is freed */
+struct world;
+
+extern const struct world *world_load(const char *path);
+extern void world_unload(const struct world *world);
+
+extern struct game *game_new(void);
+extern struct game *game_new_world(const struct world *world);
+extern int game_step(struct game *game, const char *command, struct game_output *out);
+extern void game_free(struct game *game);
+extern int game_response(const struct game *game);
+extern int game_status(const struct game *game);
+extern int game_room(const struct game *game);
+
+/* copy a game's state out and back in, to branch or rewind it cheaply */
+extern size_t game_state_size(const struct game *game);
+extern void game_snapshot(const struct game *game, void *buffer);
+extern void game_restore(struct game *game, const void *buffer);
+
+/* Step back and forth through the commands that changed the game: undo
+ * and redo one, go to a numbered checkpoint, or back to the start. The
+ * history starts over when a game is restored or loaded. Each returns 0,
+ * or -1 if there is nowhere to go. A game keeps at least its last 10000
+ * commands; game_journal() changes that, and 0 keeps none, for games that
+ * never go back.
+ */
+extern int game_journal(struct game *game, size_t commands);
+extern int game_undo(struct game *game);
+extern int game_redo(struct game *game);
+extern int game_checkpoint(struct game *game, int n);
+extern int game_rollback(struct game *game, int n);
+extern void game_restart(struct game *game);
+
+/* save a game to a file and load it back, in any game of the same world;
+ * both return 0, or -1 and set errno (EINVAL: not a save of this world) */
+extern int game_save(const struct game *game, const char *path);
+extern int game_load(struct game *game, const char *path);
+
+/* Record the commands played in a game, the response each printed and the
+ * state each left it in, and play such a recording back into a game in the
+ * same starting state; see record.c. Responses that went to a null sink
+ * are not recorded, so replay checks only the states they left.
+ * game_replay() returns how many commands matched, setting *diverged if it
+ * stopped at one that did not, or -1 and errno.
+ */
+struct recording;
+
+extern struct recording *recording_new(const struct game *game, const char *path);
+extern int recording_add(struct recording *recording, const struct game *game, const char *command);
+extern int recording_free(struct recording *recording);
+extern long game_replay(struct game *game, const char *path, int *diverged);
+
+/* Count commands, their latency and output by verb, and the items and
+ * events looked through, in a game; see metrics.c. The "stats" command
+ * shows them and game_metrics_json() appends them to out as JSON.
+ */
+extern int game_metrics(struct game *game, int on);
+extern void game_metrics_json(struct game *game, struct game_output *out);
+
+/* Keep the last records, at least that many, of what a game does: the
+ * commands it is given, the verbs and items they resolve to, the events
+ * they fire and the state they change, each stamped with the CPU's time
+ * stamp counter, in a ring in memory; see trace.h. game_trace_dump()
+ * writes the ring to fd for tracedump to print, and is safe to call from
+ * a signal handler. Both return 0, or -1 and set errno.
+ */
+extern int game_trace(struct game *game, size_t records);
+extern int game_trace_dump(const struct game *game, int fd);
+
+/* 64-bit hash of a game's state, kept up to date as it is played: games in
+ * the same state have the same hash */
+extern uint64_t game_hash(const struct game *game);
+
+#endif
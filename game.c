@@ -0,0 +1,212 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include "game.h"
+#include "world.h"
+#include "state.h"
+#include "input.h"
+#include "journal.h"
+#include "trace.h"
+static int reserve(struct game_output *out, size_t len);
+static void write_output(struct game *game, struct game_output *out);
+
+/* start a new game of the built-in world */
+extern struct game *game_new(void)
+{
+	const struct world *world;
+
+	if ((world = world_builtin()) == NULL)
+		return NULL;
+	return game_new_world(world);
+}
+
+/* start a new game in room 0 */
+extern struct game *game_new_world(const struct world *world)
+{
+	struct game *game;
+
+	if ((game = calloc(1, sizeof(*game))) == NULL)
+		return NULL;
+	game->world = world;
+	if ((game->state = state_new(game->world)) == NULL) {
+		game_free(game);
+		return NULL;
+	}
+	return game;
+}
+
+/* play one command, appending the response to out */
+extern int game_step(struct game *game, const char *command, struct game_output *out)
+{
+	uint64_t hash = game->state->hash;
+	size_t start = out->len;
+
+	TRACE_TEXT(game, TRACE_COMMAND, command);
+	game->out = out;
+	game->response = RESPONSE_NONE;
+	if (game->state->status == 0)
+		input_command(game, command);
+	journal_end(game);
+	game->out = NULL;
+
+	/* a command that was understood changed the game, or didn't */
+	if (game->response == RESPONSE_SAME) {
+		if (game->state->status != 0)
+			game->response = RESPONSE_ENDED;
+		else if (game->state->hash != hash)
+			game->response = RESPONSE_CHANGED;
+	}
+	game->response_hash = out->sink == OUTPUT_NULL ? 0 :
+		world_checksum(out->len > start ? out->text + start : "", out->len - start);
+	if (out->sink == OUTPUT_FD)
+		write_output(game, out);
+	return game->state->status;
+}
+
+/* write an fd sink's response, framed or followed by its prompt */
+static void write_output(struct game *game, struct game_output *out)
+{
+	char header[GAME_FRAME_HEADER + 1];
+	struct iovec iov[3];
+	int count = 0;
+	int i = 0;
+	ssize_t n;
+
+	if (out->framed) {
+		snprintf(header, sizeof(header), "%08x %c %2d %10d %016llx\n",
+			(unsigned)out->len, GAME_FRAME_CLASSES[game->response],
+			game->state->status, game->state->room,
+			(unsigned long long)game->state->hash);
+		iov[count].iov_base = header;
+		iov[count++].iov_len = GAME_FRAME_HEADER;
+	}
+	if (out->len > 0) {
+		iov[count].iov_base = out->text;
+		iov[count++].iov_len = out->len;
+	}
+	if (game->state->status == 0 && out->prompt != NULL) {
+		iov[count].iov_base = (char *)out->prompt;
+		iov[count++].iov_len = strlen(out->prompt);
+	}
+	out->len = 0;
+	while (i < count) {
+		if ((n = writev(out->fd, iov + i, count - i)) == -1) {
+			if (errno == EINTR)
+				continue;
+			out->error = errno;
+			return;
+		}
+		for (; i < count && (size_t)n >= iov[i].iov_len; i++)
+			n -= iov[i].iov_len;
+		if (i < count) {
+			iov[i].iov_base = (char *)iov[i].iov_base + n;
+			iov[i].iov_len -= n;
+		}
+	}
+}
+
+extern void game_free(struct game *game)
+{
+	if (game == NULL)
+		return;
+	journal_free(game);
+	free(game->metrics);
+	free(game->trace);
+	free(game->state);
+	free(game->line);
+	free(game);
+}
+
+extern int game_response(const struct game *game)
+{
+	return game->response;
+}
+
+extern int game_status(const struct game *game)
+{
+	return game->state->status;
+}
+
+extern int game_room(const struct game *game)
+{
+	return game->state->room;
+}
+
+extern size_t game_state_size(const struct game *game)
+{
+	return game->world->state_size;
+}
+
+extern void game_snapshot(const struct game *game, void *buffer)
+{
+	memcpy(buffer, game->state, game->world->state_size);
+}
+
+extern void game_restore(struct game *game, const void *buffer)
+{
+	memcpy(game->state, buffer, game->world->state_size);
+	journal_clear(game);
+}
+
+extern uint64_t game_hash(const struct game *game)
+{
+	return game->state->hash;
+}
+
+/* make room for len more characters and the terminating NUL */
+static int reserve(struct game_output *out, size_t len)
+{
+	size_t size;
+	char *text;
+
+	if (out->len + len < out->size)
+		return 0;
+	for (size = out->size ? out->size : 256; size <= out->len + len; size *= 2)
+		;
+	if ((text = realloc(out->text, size)) == NULL)
+		return 1;
+	out->text = text;
+	out->size = size;
+	return 0;
+}
+
+extern void game_printf(struct game *game, const char *format, ...)
+{
+	struct game_output *out = game->out;
+	va_list args;
+	int len;
+
+	if (out->sink == OUTPUT_NULL || reserve(out, 0))
+		return;
+	va_start(args, format);
+	len = vsnprintf(out->text + out->len, out->size - out->len, format, args);
+	va_end(args);
+	if (len < 0)
+		return;
+
+	/* didn't fit, grow and try again */
+	if ((size_t)len >= out->size - out->len) {
+		if (reserve(out, len)) {
+			out->text[out->len] = '\0';
+			return;
+		}
+		va_start(args, format);
+		vsnprintf(out->text + out->len, out->size - out->len, format, args);
+		va_end(args);
+	}
+	out->len += len;
+}
+
+extern void game_putchar(struct game *game, int c)
+{
+	struct game_output *out = game->out;
+
+	if (out->sink == OUTPUT_NULL || reserve(out, 1))
+		return;
+	out->text[out->len++] = c;
+	out->text[out->len] = '\0';
+}
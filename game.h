@@ -0,0 +1,28 @@
+#ifndef GAME_H
+#define GAME_H
+
+#include "forest.h"
+
+struct world;
+struct state;
+struct journal;
+struct metrics;
+struct trace;
+
+struct game {
+	const struct world *world;	/* shared, read-only tables */
+	struct state *state;		/* everything that changes during play */
+	struct journal *journal;	/* the changes made to it, for undo */
+	struct metrics *metrics;	/* counters, or NULL when off */
+	struct trace *trace;		/* what it did lately, or NULL */
+	struct game_output *out;	/* where the current response goes */
+	int response;			/* RESPONSE_*, of the last command */
+	uint64_t response_hash;		/* world_checksum() of its text, 0 in a null sink */
+	char *line;			/* the command being parsed, in words */
+	size_t line_size;
+};
+
+extern void game_printf(struct game *game, const char *format, ...);
+extern void game_putchar(struct game *game, int c);
+
+#endif
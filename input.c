@@ -1,221 +1,422 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <unistd.h>
+#include <errno.h>
+#include "input.h"
+#include "state.h"
 #include "rooms.h"
 #include "items.h"
 #include "inter.h"
-static void parse_input(char *line);
-static void display_help(void);
-static void quit_screen(void);
-static void bad_ending(void);
-static void good_ending(void);
-int GAME_STATUS;
-
-#define READLINE_MAX_LINE 80
-
-static char *readline() {
-    char buf[READLINE_MAX_LINE];
-	size_t len;
-
-	printf("command> ");
-	fflush(stdout);
-	if (fgets(buf,READLINE_MAX_LINE,stdin) == NULL) return NULL;
-	len = strlen(buf);
-	while(len && (buf[len-1] == '\n' || buf[len-1] == '\r')) {
-		len--;
-		buf[len] = '\0';
+#include "world.h"
+#include "metrics.h"
+#include "trace.h"
+static void parse_input(struct game *game, const char *line);
+static int read_words(struct game *game, const char *line, struct word word[8]);
+static void quit_cmd(struct game *game, const struct word **args, int arg);
+static void help_cmd(struct game *game, const struct word **args, int arg);
+static void look_cmd(struct game *game, const struct word **args, int arg);
+static void walk_cmd(struct game *game, const struct word **args, int arg);
+static void walk_dir_cmd(struct game *game, const struct word **args, int arg);
+static void take_cmd(struct game *game, const struct word **args, int arg);
+static void drop_cmd(struct game *game, const struct word **args, int arg);
+static void search_cmd(struct game *game, const struct word **args, int arg);
+static void inventory_cmd(struct game *game, const struct word **args, int arg);
+static void use_cmd(struct game *game, const struct word **args, int arg);
+static void save_cmd(struct game *game, const struct word **args, int arg);
+static void load_cmd(struct game *game, const struct word **args, int arg);
+static void undo_cmd(struct game *game, const struct word **args, int arg);
+static void redo_cmd(struct game *game, const struct word **args, int arg);
+static void checkpoint_cmd(struct game *game, const struct word **args, int arg);
+static void rollback_cmd(struct game *game, const struct word **args, int arg);
+static void restart_cmd(struct game *game, const struct word **args, int arg);
+static void stats_cmd(struct game *game, const struct word **args, int arg);
+static int checkpoint_number(struct game *game, const struct word *word, int *n);
+static int save_path(struct game *game, const struct word *name, char *path, size_t size);
+static void display_help(struct game *game);
+static void quit_screen(struct game *game);
+static void bad_ending(struct game *game);
+static void good_ending(struct game *game);
+
+/* what a handler is given: nothing, the words naming an item, or all words */
+enum { NONE, OBJECT, WORDS };
+
+/* a command word, see verbs.txt */
+struct verb {
+	const char *word;
+	void (*handler)(struct game *game, const struct word **args, int arg);
+	int grammar;
+	int arg;
+};
+
+#include "verbs.h"
+
+_Static_assert(sizeof(verb_table) / sizeof(*verb_table) <= METRIC_VERBS,
+	"metrics have a slot for each verb");
+
+/* play one command line, and show the ending if it finished the game */
+extern void input_command(struct game *game, const char *line)
+{
+	if (line[0] == '\0')
+		return;
+	parse_input(game, line);
+	if (game->state->status == -1) {
+		quit_screen(game);
+	} else if (game->state->status == -2) {
+		bad_ending(game);
+	} else if (game->state->status == -3) {
+		good_ending(game);
 	}
-	return strdup(buf);
 }
 
-/* main input loop */
-extern void input_loop(void)
+/* parse input and direct commands */
+static void parse_input(struct game *game, const char *line)
 {
-	char *line;
+	int i;
+	int count;
+	struct word word[8];
+	const struct word *words[8];
+	const struct verb *verb;
 
-	/* Start in room 0 and show it */
-	look_room();
-	GAME_STATUS = 0;
+	/* time the whole command, tokenizing and interning included */
+	METRIC_START(game);
 
-	/* main input loop */
-	while(putchar('\n') && (line = readline()) != NULL) {
-		if (line[0] != '\0') {
-			parse_input(line);
-			if (GAME_STATUS == -1) {
-				quit_screen();
-				break;
-			} else if (GAME_STATUS == -2) {
-				bad_ending();
-				break;
-			} else if (GAME_STATUS == -3) {
-				good_ending();
+	/* split the line into separate words, NULL after the last */
+	count = read_words(game, line, word);
+	for (i = 0; i < 8; i++)
+		*(words+i) = i < count ? &word[i] : NULL;
+
+	/* parse input */
+	if (*words == NULL)
+		return;
+	verb = verb_lookup((*words)->text);
+	TRACE_TEXT(game, TRACE_VERB, verb != NULL ? verb->word : "");
+	if (verb == NULL) {
+		/* unknown command given */
+		game_printf(game, "\nUnknown command '%s",(*words)->text);
+		for (i = 1; i < 4; i++) {
+			if (*(words+i) != NULL) game_printf(game, " %s",(*(words+i))->text);
+		}
+		game_printf(game, "'.\n");
+		game->response = RESPONSE_UNKNOWN;
+		METRIC_VERB(game, METRIC_VERBS, "unknown");
+		return;
+	}
+
+	/* direct command */
+	game->response = RESPONSE_SAME;
+	if (verb->grammar == WORDS) {
+		verb->handler(game, words, verb->arg);
+	} else if (verb->grammar == OBJECT && *(words+1) != NULL && (*(words+1))->token == WORD_THE) {
+		verb->handler(game, words+2, verb->arg);
+	} else {
+		verb->handler(game, words+1, verb->arg);
+	}
+	METRIC_VERB(game, verb - verb_table, verb->word);
+}
+
+/* Copy the line into the game's buffer in one pass, lowercasing it,
+ * cutting it into at most eight words and looking each word up as it
+ * ends. The buffer only grows, so commands don't allocate once it is
+ * big enough. Returns the number of words.
+ */
+static int read_words(struct game *game, const char *line, struct word word[8])
+{
+	char *buffer = game->line;
+	size_t i;
+	size_t start = 0;
+	unsigned hash = WORD_HASH_START;
+	int count = 0;
+	char c;
+
+	for (i = 0; count < 8; i++) {
+		if (i == game->line_size) {
+			if ((buffer = realloc(game->line, i * 2 + 64)) == NULL)
 				break;
+			game->line = buffer;
+			game->line_size = i * 2 + 64;
+		}
+		if ((c = line[i]) >= 'A' && c <= 'Z')
+			c = c + 'a' - 'A';
+		if (c == ' ' || c == '\n' || c == '\0') {
+			buffer[i] = '\0';
+			if (i > start) {
+				word[count].text = buffer + start;
+				word[count].token = world_word(game->world, buffer + start, hash);
+				count++;
 			}
+			if (c == '\0')
+				break;
+			start = i + 1;
+			hash = WORD_HASH_START;
+		} else {
+			buffer[i] = c;
+			hash = WORD_HASH_STEP(hash, c);
 		}
-		free(line);
 	}
+	return count;
 }
 
-/* parse input and direct commands */
-static void parse_input(char *line)
+/* user quit */
+static void quit_cmd(struct game *game, const struct word **args, int arg)
 {
-	int i;
-	char allwords[100];
-	char *words[8];
-
-	/* copy the line and convert to lowercase */
-	for (i = 0; i < 99 && line[i] != '\0'; i++) {
-		allwords[i] = line[i];
-		if (allwords[i] >= 'A' && allwords[i] <= 'Z')
-			allwords[i] = allwords[i] + 'a' - 'A';
+	set_status(game, -1);
+}
+
+/* user help */
+static void help_cmd(struct game *game, const struct word **args, int arg)
+{
+	display_help(game);
+}
+
+/* look at room, or at an item */
+static void look_cmd(struct game *game, const struct word **words, int arg)
+{
+	if (*(words+1) == NULL) {
+		look_room(game);
+	} else if ((*(words+1))->token == WORD_AT) {
+		if (*(words+2) != NULL && (*(words+2))->token == WORD_THE) {
+			look_item(game, room_id(game), *(words+3), *(words+4));
+		} else {
+			look_item(game, room_id(game), *(words+2), *(words+3));
+		}
+	} else {
+		look_item(game, room_id(game), *(words+1), *(words+2));
 	}
-	allwords[i] = '\0';
+}
 
-	/* split the line into separate words */
-	*words = strtok(allwords, " \n");
-	for(i = 1; i < 8; i++)
-		*(words+i) = strtok(NULL, " \n");
+/* move */
+static void walk_cmd(struct game *game, const struct word **words, int arg)
+{
+	move(game, *(words+1) == NULL ? NULL : (*(words+1))->text);
+}
 
-	/* parse input */
-	if (*words == NULL) {
+static void walk_dir_cmd(struct game *game, const struct word **args, int dir)
+{
+	move_dir(game, dir);
+}
+
+/* item functions */
+static void take_cmd(struct game *game, const struct word **args, int arg)
+{
+	take_item(game, room_id(game), *args, *(args+1));
+}
+
+static void drop_cmd(struct game *game, const struct word **args, int arg)
+{
+	drop_item(game, room_id(game), *args, *(args+1));
+}
+
+static void search_cmd(struct game *game, const struct word **args, int arg)
+{
+	search(game, room_id(game));
+}
+
+static void inventory_cmd(struct game *game, const struct word **args, int arg)
+{
+	list_inv(game);
+}
+
+/* interactions */
+static void use_cmd(struct game *game, const struct word **words, int arg)
+{
+	use(game, words);
+}
+
+/* saved games, as name.sav in the current directory */
+static void save_cmd(struct game *game, const struct word **words, int arg)
+{
+	char path[80];
+
+	if (save_path(game, *(words+1), path, sizeof(path)))
 		return;
+	if (game_save(game, path) == -1)
+		game_printf(game, "\nCould not save %s: %s.\n", path, strerror(errno));
+	else
+		game_printf(game, "\nGame saved as %s.\n", (*(words+1))->text);
+}
+
+static void load_cmd(struct game *game, const struct word **words, int arg)
+{
+	char path[80];
+
+	if (save_path(game, *(words+1), path, sizeof(path)))
+		return;
+	if (game_load(game, path) == 0) {
+		game_printf(game, "\nGame %s loaded.\n", (*(words+1))->text);
+		look_room(game);
+	} else if (errno == ENOENT) {
+		game_printf(game, "\nThere is no saved game called %s.\n", (*(words+1))->text);
+	} else if (errno == EINVAL) {
+		game_printf(game, "\n%s is not a saved game of this world.\n", path);
+	} else {
+		game_printf(game, "\nCould not load %s: %s.\n", path, strerror(errno));
 	}
-	
-	/* user quit */
-	else if (strcmp(*words,"quit") == 0 || strcmp(*words,"exit") == 0 || strcmp(*words,"q") == 0) {
-		GAME_STATUS = -1;
-	}
+}
 
-	/* user help */
-	else if (strcmp(*words, "help") == 0 || strcmp(*words, "h") == 0) {
-		display_help();
+/* going back through the commands played */
+static void undo_cmd(struct game *game, const struct word **args, int arg)
+{
+	if (game_undo(game) == -1) {
+		game_printf(game, "\nThere is nothing to undo.\n");
+		return;
 	}
+	game_printf(game, "\nYou take back your last move.\n");
+	look_room(game);
+}
 
-	/* look at room */
-	else if (strcmp(*words, "look") == 0 && *(words+1) == NULL) {
-		look_room();
+static void redo_cmd(struct game *game, const struct word **args, int arg)
+{
+	if (game_redo(game) == -1) {
+		game_printf(game, "\nThere is nothing to redo.\n");
+		return;
 	}
+	game_printf(game, "\nYou make your move again.\n");
+	look_room(game);
+}
+
+static void checkpoint_cmd(struct game *game, const struct word **words, int arg)
+{
+	int n;
+
+	if (checkpoint_number(game, *(words+1), &n))
+		return;
+	if (game_checkpoint(game, n) == -1)
+		game_printf(game, "\nCould not set checkpoint %d.\n", n);
+	else
+		game_printf(game, "\nCheckpoint %d set.\n", n);
+}
+
+static void rollback_cmd(struct game *game, const struct word **words, int arg)
+{
+	int n;
 
-	/* move */
-	else if (strcmp(*words, "go") == 0 || strcmp(*words, "walk") == 0 || strcmp(*words, "move") == 0) {
-		move(*(words+1));
-	} else if (strcmp(*words, "north") == 0 || strcmp(*words, "east") == 0 || strcmp(*words, "south") == 0 ||
-		strcmp(*words, "west") == 0) {
-		move(*words);
-	} else if (strcmp(*words, "n") == 0) {
-		move("north");
-	} else if (strcmp(*words, "e") == 0) {
-		move("east");
-	} else if (strcmp(*words, "s") == 0) {
-		move("south");
-	} else if (strcmp(*words, "w") == 0) {
-		move("west");
+	if (checkpoint_number(game, *(words+1), &n))
+		return;
+	if (game_rollback(game, n) == -1) {
+		game_printf(game, "\nThere is no checkpoint %d.\n", n);
+		return;
 	}
+	game_printf(game, "\nYou are back at checkpoint %d.\n", n);
+	look_room(game);
+}
 
-	/* item functions */
-	else if (strcmp(*words,"take") == 0 || strcmp(*words,"get") == 0) {
-		if (*(words+1) != NULL && strcmp(*(words+1),"the") == 0) {
-			take_item(room_id(), *(words+2), *(words+3));
-		} else {
-			take_item(room_id(), *(words+1), *(words+2));
-		}
-	} else if (strcmp(*words,"drop") == 0) {
-		if (*(words+1) != NULL && strcmp(*(words+1),"the") == 0) {
-			drop_item(room_id(), *(words+2), *(words+3));
-		} else {
-			drop_item(room_id(), *(words+1), *(words+2));
-		}
-	} else if (strcmp(*words,"search") == 0 || strcmp(*words,"find") == 0) {
-		search(room_id());
-	} else if (strcmp(*words,"i") == 0 || strcmp(*words,"inventory") == 0 || strcmp(*words,"inv") == 0) {
-		list_inv();
-	} else if (strcmp(*words,"look") == 0) {
-		if (strcmp(*(words+1),"at") == 0) {
-			if (*(words+2) != NULL && strcmp(*(words+2),"the") == 0) {
-				look_item(room_id(), *(words+3), *(words+4));
-			} else {
-				look_item(room_id(), *(words+2), *(words+3));
-			}
-		} else {
-			look_item(room_id(), *(words+1), *(words+2));
+static void restart_cmd(struct game *game, const struct word **args, int arg)
+{
+	game_restart(game);
+	game_printf(game, "\nYou are back where you started.\n");
+	look_room(game);
+}
+
+/* what the game's metrics have counted so far */
+static void stats_cmd(struct game *game, const struct word **args, int arg)
+{
+	metrics_print(game);
+}
+
+static int checkpoint_number(struct game *game, const struct word *word, int *n)
+{
+	const char *p;
+
+	if (word != NULL) {
+		for (p = word->text; *p >= '0' && *p <= '9'; p++)
+			;
+		if (*p == '\0' && p > word->text && p - word->text <= 9) {
+			*n = atoi(word->text);
+			return 0;
 		}
 	}
+	game_printf(game, "\nWhich checkpoint number?\n");
+	return 1;
+}
 
-	/* interactions */
-	else if (strcmp(*words,"use") == 0) {
-		use(words);
-	}
+/* the file for a saved game's name, which must be a plain word */
+static int save_path(struct game *game, const struct word *name, char *path, size_t size)
+{
+	const char *p;
 
-	/* unknown command given */
-	else {
-		printf("\nUnknown command '%s",*words);
-		for (i = 1; i < 4; i++) {
-			if (*(words+i) != NULL) printf(" %s",*(words+i));
-		}
-		printf("'.\n");
+	if (name == NULL) {
+		game_printf(game, "\nWhich name should the game go under?\n");
+		return 1;
+	}
+	for (p = name->text; *p != '\0'; p++) {
+		if (!((*p >= 'a' && *p <= 'z') || (*p >= '0' && *p <= '9') || *p == '-' || *p == '_'))
+			break;
 	}
+	if (*p != '\0' || p - name->text > 64) {
+		game_printf(game, "\nA saved game's name is a word of letters, digits, - and _.\n");
+		return 1;
+	}
+	snprintf(path, size, "%s.sav", name->text);
+	return 0;
 }
 
-static void display_help(void)
-{
-	printf("\n--------------------------------------------------------------------------------\n");
-	printf("HOW TO PLAY\n");
-	printf("\tExplore the world and solve the mystery of the forest!\n");
-	printf("\tTo perform an action, use the following commands:\n");
-	printf("--------------------------------------------------------------------------------\n");
-	printf("NAVIGATING THE WORLD\n");
-	printf("\twalk direction (or just direction) - move in the direction specified\n");
-	printf("\tlook - examine your surroundings\n");
-	printf("--------------------------------------------------------------------------------\n");
-	printf("MANAGING ITEMS\n");
-	printf("\tinventory - list your belongings\n");
-	printf("\ttake - pick up an item\n");
-	printf("\tdrop - drop an item\n");
-	printf("--------------------------------------------------------------------------------\n");
-	printf("INTERACTING WITH THE WORLD\n");
-	printf("\tsearch - look for hidden objects\n");
-	printf("\tuse - use an item or items\n");
-	printf("--------------------------------------------------------------------------------\n");
-	printf("TO QUIT\n");
-	printf("\tquit - give up in your search and go home\n");
-	printf("--------------------------------------------------------------------------------\n");
+static void display_help(struct game *game)
+{
+	game_printf(game, "\n--------------------------------------------------------------------------------\n");
+	game_printf(game, "HOW TO PLAY\n");
+	game_printf(game, "\tExplore the world and solve the mystery of the forest!\n");
+	game_printf(game, "\tTo perform an action, use the following commands:\n");
+	game_printf(game, "--------------------------------------------------------------------------------\n");
+	game_printf(game, "NAVIGATING THE WORLD\n");
+	game_printf(game, "\twalk direction (or just direction) - move in the direction specified\n");
+	game_printf(game, "\tlook - examine your surroundings\n");
+	game_printf(game, "--------------------------------------------------------------------------------\n");
+	game_printf(game, "MANAGING ITEMS\n");
+	game_printf(game, "\tinventory - list your belongings\n");
+	game_printf(game, "\ttake - pick up an item\n");
+	game_printf(game, "\tdrop - drop an item\n");
+	game_printf(game, "--------------------------------------------------------------------------------\n");
+	game_printf(game, "INTERACTING WITH THE WORLD\n");
+	game_printf(game, "\tsearch - look for hidden objects\n");
+	game_printf(game, "\tuse - use an item or items\n");
+	game_printf(game, "--------------------------------------------------------------------------------\n");
+	game_printf(game, "SAVING AND GOING BACK\n");
+	game_printf(game, "\tsave name - save the game under a name\n");
+	game_printf(game, "\tload name - go back to a saved game\n");
+	game_printf(game, "\tundo, redo - take back your last move, or make it again\n");
+	game_printf(game, "\tcheckpoint number - mark where you are\n");
+	game_printf(game, "\trollback number - go back to a checkpoint\n");
+	game_printf(game, "\trestart - go back to the start\n");
+	game_printf(game, "--------------------------------------------------------------------------------\n");
+	game_printf(game, "TO QUIT\n");
+	game_printf(game, "\tquit - give up in your search and go home\n");
+	game_printf(game, "--------------------------------------------------------------------------------\n");
 }
 
 /* Displayed upon exiting the game */
-static void quit_screen(void)
+static void quit_screen(struct game *game)
 {
-	printf("\n--------------------------------------------------------------------------------\n");
-	printf("GAME OVER: The mystery of the forest remains unsolved!\n");
-	printf("--------------------------------------------------------------------------------\n\n");
+	game_printf(game, "\n--------------------------------------------------------------------------------\n");
+	game_printf(game, "GAME OVER: The mystery of the forest remains unsolved!\n");
+	game_printf(game, "--------------------------------------------------------------------------------\n\n");
 }
 
 /* bad ending */
-static void bad_ending(void)
+static void bad_ending(struct game *game)
 {
-	printf("\n--------------------------------------------------------------------------------\n");
-	printf("YOU GOT THE BAD ENDING\n");
-	printf("--------------------------------------------------------------------------------\n");
-	printf("How could you have known you were going to release an ancient horror upon the\n");
-	printf("people of the world? Nobody can really blame you, but as the giant statue\n");
-	printf("rampages across the world, killing all who oppose him, subjugating everyone\n");
-	printf("else, you are trapped in the Hidden Temple with no way out.\n");
-	printf("--------------------------------------------------------------------------------\n");
-	printf("GAME OVER: BETTER LUCK NEXT TIME!\n");
-	printf("--------------------------------------------------------------------------------\n\n");
+	game_printf(game, "\n--------------------------------------------------------------------------------\n");
+	game_printf(game, "YOU GOT THE BAD ENDING\n");
+	game_printf(game, "--------------------------------------------------------------------------------\n");
+	game_printf(game, "How could you have known you were going to release an ancient horror upon the\n");
+	game_printf(game, "people of the world? Nobody can really blame you, but as the giant statue\n");
+	game_printf(game, "rampages across the world, killing all who oppose him, subjugating everyone\n");
+	game_printf(game, "else, you are trapped in the Hidden Temple with no way out.\n");
+	game_printf(game, "--------------------------------------------------------------------------------\n");
+	game_printf(game, "GAME OVER: BETTER LUCK NEXT TIME!\n");
+	game_printf(game, "--------------------------------------------------------------------------------\n\n");
 }
 
 /* good ending */
-static void good_ending(void)
-{
-	printf("\n--------------------------------------------------------------------------------\n");
-	printf("YOU GOT THE GOOD ENDING\n");
-	printf("--------------------------------------------------------------------------------\n");
-	printf("You have solved the secret of the Hidden Temple! By destroying the giant statue,\n");
-	printf("you have uncovered a cache of riches beyond your wildest dreams! What will you\n");
-	printf("do with your newfound wealth? Become a king? Become a god? The choice is up to\n");
-	printf("you! But first, you need to find a cart...\n");
-	printf("--------------------------------------------------------------------------------\n");
-	printf("CONGRATULATIONS!\n");
-	printf("--------------------------------------------------------------------------------\n\n");
+static void good_ending(struct game *game)
+{
+	game_printf(game, "\n--------------------------------------------------------------------------------\n");
+	game_printf(game, "YOU GOT THE GOOD ENDING\n");
+	game_printf(game, "--------------------------------------------------------------------------------\n");
+	game_printf(game, "You have solved the secret of the Hidden Temple! By destroying the giant statue,\n");
+	game_printf(game, "you have uncovered a cache of riches beyond your wildest dreams! What will you\n");
+	game_printf(game, "do with your newfound wealth? Become a king? Become a god? The choice is up to\n");
+	game_printf(game, "you! But first, you need to find a cart...\n");
+	game_printf(game, "--------------------------------------------------------------------------------\n");
+	game_printf(game, "CONGRATULATIONS!\n");
+	game_printf(game, "--------------------------------------------------------------------------------\n\n");
 }
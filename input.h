@@ -1,6 +1,8 @@
 #ifndef INPUT_H
 #define INPUT_H
 
-extern void input_loop(void);
+#include "game.h"
+
+extern void input_command(struct game *game, const char *line);
 
 #endif
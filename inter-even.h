@@ -1,33 +1,6 @@
-struct event {
-	const int event_id;
-	const int item1;
-	const int item2;
-	const int room_id;
-	int triggerable;
-	const int event_type;
-	const int event_dir;
-	const int event_attr1;
-	const int event_attr2;
-	const int event_link;
-	const int quit;
-	const char *event_desc;
-};
-
-#define NO 0
-#define YES 1
-
-#define OPEN 0
-#define BREAK 1
-#define CREATE 2
-#define STORY 3
-#define TAKE 4
-
-#define NORTH 0
-#define EAST 1
-#define SOUTH 2
-#define WEST 3
+/* interactions of the built-in world, see struct event_desc in world.h */
 
-static struct event interactions[] = {
+static const struct event_desc interactions[] = {
 	/* lever to hidden temple */
 	{0,11,-1,32,YES,OPEN,NORTH,32,33,1,YES,
 		"You put all your strength into moving the lever. It finally moves and the large\n"
@@ -2,36 +2,37 @@
 #include <stdlib.h>
 #include <string.h>
 #include "inter.h"
-#include "inter-even.h"
+#include "state.h"
 #include "items.h"
 #include "rooms.h"
-static void interact(int room, int item1, int item2);
-extern int GAME_STATUS;
+#include "metrics.h"
+#include "trace.h"
+static void interact(struct game *game, int room, int item1, int item2);
 
 /* use item word parsing:
  *	I have simplified this. It's still a little gross to look at, but it
  *	should make a lot more sense now!
  */
-extern void use(char *input[8])
+extern void use(struct game *game, const struct word *input[8])
 {
 	int i;
 	int j;
 	int room;
 	int items[2];
 	int cur_phrase;
-	char *words[4];
+	const struct word *words[4];
 
-	putchar('\n');
+	game_putchar(game, '\n');
 
 	/* initialize words to null */
 	for (i = 0; i < 4; i++)
 		words[i] = NULL;
 
 	/* condense input to four words at most */
-	for (j = 0, i = 1; i < 8; i++) {
+	for (j = 0, i = 1; i < 8 && j < 4; i++) {
 		if (input[i] == NULL ||
-			strcmp(input[i],"on") == 0 ||
-			strcmp(input[i],"the") == 0) {
+			input[i]->token == WORD_ON ||
+			input[i]->token == WORD_THE) {
 			continue;
 		} else {
 			words[j] = input[i];
@@ -41,12 +42,12 @@ extern void use(char *input[8])
 
 	/* Make sure something was used */
 	if (words[0] == NULL) {
-		printf("Use what?\n");
+		game_printf(game, "Use what?\n");
 		return;
 	}
 
 	/* room id for item information */
-	room = room_id();
+	room = room_id(game);
 
 	/* process word by word */
 	for (j = 0, i = 0; i < 3 && j < 2; i++) {
@@ -54,12 +55,12 @@ extern void use(char *input[8])
 			items[j] = -1;
 			break;
 		}
-		if ((cur_phrase = unique_item(room, NULL, words[i])) == -2) {
-			printf("Which %s?\n",words[i]);
+		if ((cur_phrase = unique_item(game, room, NULL, words[i])) == -2) {
+			game_printf(game, "Which %s?\n",words[i]->text);
 			return;
 		} else if (cur_phrase == -1) {
-			if ((cur_phrase = unique_item(room, words[i], words[i+1])) == -1) {
-				printf("There is no %s here.\n",words[i]);
+			if ((cur_phrase = unique_item(game, room, words[i], words[i+1])) == -1) {
+				game_printf(game, "There is no %s here.\n",words[i]->text);
 				return;
 			}
 			i++;
@@ -68,48 +69,58 @@ extern void use(char *input[8])
 	}
 
 	/* parsed items, now use them */
-	interact(room, items[0], items[1]);
+	interact(game, room, items[0], items[1]);
 }
 
-static void interact(int room, int item1, int item2)
+static void interact(struct game *game, int room, int item1, int item2)
 {
+	const struct event *events = game->world->events;
+	const struct chain *chain;
 	int i;
-	for (i = 0; interactions[i].event_id != -1; i++) {
-		if (interactions[i].room_id == room &&
-			interactions[i].item1 == item1 &&
-			interactions[i].item2 == item2 &&
-			interactions[i].triggerable == YES) {
+	int j;
+
+	/* only the events for this room and these items can fire */
+	chain = world_chain(game->world, room, item1, item2);
+	for (j = 0; chain != NULL && j < chain->count; j++) {
+		i = game->world->chain_events[chain->first + j];
+		if (event_triggerable(game, i)) {
+			TRACE(game, TRACE_EVENT, i, events[i].event_type, room);
 			/* do the action */
-			if (interactions[i].event_type == OPEN) {
-				location_move(interactions[i].event_attr1,
-					interactions[i].event_dir,
-					interactions[i].event_attr2);
-			} else if (interactions[i].event_type == BREAK) {
-				break_item(interactions[i].event_attr1);
-			} else if (interactions[i].event_type == CREATE) {
-				create_item(interactions[i].event_attr1, interactions[i].event_attr2);
-			} else if (interactions[i].event_type == STORY) {
-				GAME_STATUS = interactions[i].event_attr1;
-			} else if (interactions[i].event_type == TAKE) {
-				take(interactions[i].event_attr1);
+			if (events[i].event_type == OPEN) {
+				location_move(game, events[i].event_attr1,
+					events[i].event_dir,
+					events[i].event_attr2);
+			} else if (events[i].event_type == BREAK) {
+				break_item(game, events[i].event_attr1);
+			} else if (events[i].event_type == CREATE) {
+				create_item(game, events[i].event_attr1, events[i].event_attr2);
+			} else if (events[i].event_type == STORY) {
+				set_status(game, events[i].event_attr1);
+			} else if (events[i].event_type == TAKE) {
+				take(game, events[i].event_attr1);
 			}
 
 			/* print description */
-			if (interactions[i].event_desc != NULL)
-				printf("%s\n",interactions[i].event_desc);
+			if (events[i].event_desc != 0)
+				game_printf(game, "%s\n",world_string(game->world, events[i].event_desc));
 			/* deactivate current event, and activate linked event if necessary */
-			interactions[i].triggerable = NO;
-			if (interactions[i].event_link != -1) {
-				if (interactions[interactions[i].event_link].triggerable == YES)
-					interactions[interactions[i].event_link].triggerable = NO;
+			set_event_triggerable(game, i, NO);
+			if (events[i].event_link != -1) {
+				if (event_triggerable(game, events[i].event_link))
+					set_event_triggerable(game, events[i].event_link, NO);
 				else
-					interactions[interactions[i].event_link].triggerable = YES;
+					set_event_triggerable(game, events[i].event_link, YES);
 			}
 
 			/* if you don't want to chain together events, quit now */
-			if (interactions[i].quit == YES) return;
+			if (events[i].quit == YES) {
+				METRIC_ADD(game, events_scanned, j + 1);
+				return;
+			}
 		}
 	}
+	METRIC_ADD(game, events_scanned, j);
+
 	/* got to the end with nothing happening */
-	printf("You can't do that.\n");
+	game_printf(game, "You can't do that.\n");
 }
@@ -1,6 +1,9 @@
 #ifndef INTER_H
 #define INTER_H
 
-extern void use(char *words[8]);
+#include "game.h"
+#include "world.h"
+
+extern void use(struct game *game, const struct word *words[8]);
 
 #endif
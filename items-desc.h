@@ -1,21 +1,9 @@
-struct item {
-	const int item_id;
-	const char *item_name;
-	const char *item_adj;
-	const char *item_desc_floor;
-	const char *item_desc_exam;
-	int hidden;
-	int takeable;
-	int location;
-};
-
-#define NO 0
-#define YES 1
+/* items of the built-in world, see struct item_desc in world.h */
 
 /* non-takeable items should be listed first, so that they will appear before
  * anything dropped in the room.
  */
-struct item items[] = {
+static const struct item_desc items[] = {
 	{
 		0,
 		"blacksmith","old",
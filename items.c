@@ -2,25 +2,27 @@
 #include <stdlib.h>
 #include <string.h>
 #include "items.h"
-#include "items-desc.h"
+#include "state.h"
 #include "rooms.h"
-static void assign_name(char **word1, char **word2, char **adj, char **name);
-static int in_room(int room_id, char *adj, char *name);
-static int in_inv(char *adj, char *name);
-
+#include "metrics.h"
+#include "trace.h"
+static void assign_name(const struct word **word1, const struct word **word2, const struct word **adj, const struct word **name);
+static int in_room(struct game *game, int room_id, const struct word *adj, const struct word *name);
+static int in_inv(struct game *game, const struct word *adj, const struct word *name);
 
 /* display items in room */
-extern void room_items(int room_id)
+extern void room_items(struct game *game, int room_id)
 {
+	const struct item *items = game->world->items;
 	int i;
-	for(i = 0; items[i].item_id != -1; i++) {
-		if (items[i].location == room_id && items[i].hidden == NO)
-			printf("%s\n",items[i].item_desc_floor);
+	for(i = room_first(game, room_id); i != -1; i = room_next(game, i)) {
+		if (!item_hidden(game, i))
+			game_printf(game, "%s\n",world_string(game->world, items[i].item_desc_floor));
 	}
 }
 
 /* function for item grammar */
-static void assign_name(char **word1, char **word2, char **adj, char **name)
+static void assign_name(const struct word **word1, const struct word **word2, const struct word **adj, const struct word **name)
 {
 	if (*word2 == NULL) {
 		*adj = NULL;
@@ -31,106 +33,117 @@ static void assign_name(char **word1, char **word2, char **adj, char **name)
 	}
 }
 
-/* inventory stuff */
-static char inventory[100] = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
-
 /* search for hidden items */
-extern void search(int room_id)
+extern void search(struct game *game, int room_id)
 {
+	const struct item *items = game->world->items;
 	int i;
+	int next;
 	int count;
 
-	putchar('\n');
+	game_putchar(game, '\n');
 
-	if (search_desc())
-		printf("You carefully search the area. ");
+	if (search_desc(game))
+		game_printf(game, "You carefully search the area. ");
 
-	for (count = 0, i = 0; items[i].item_id != -1; i++) {
-		if (items[i].location == room_id && items[i].hidden == YES) {
+	/* found items leave the room, so step ahead first */
+	for (count = 0, i = room_first(game, room_id); i != -1; i = next) {
+		next = room_next(game, i);
+		if (item_hidden(game, i)) {
 			if (count > 0)
-				printf("\nYou also found the ");
+				game_printf(game, "\nYou also found the ");
 			else
-				printf("You found the ");
+				game_printf(game, "You found the ");
 			count++;
-			if (items[i].item_adj != NULL)
-				printf("%s ",items[i].item_adj);
-			printf("%s!",items[i].item_name);
-			items[i].hidden = NO;
-			items[i].location = -1;
-			inventory[i] = 1;
+			if (items[i].item_adj != 0)
+				game_printf(game, "%s ",world_string(game->world, items[i].item_adj));
+			game_printf(game, "%s!",world_string(game->world, items[i].item_name));
+			set_item_hidden(game, i, NO);
+			set_item_location(game, i, -1);
+			set_in_inventory(game, i, YES);
 		}
 	}
 	if (count == 0)
-		printf("You didn't find anything.\n");
+		game_printf(game, "You didn't find anything.\n");
 	else
-		putchar('\n');
+		game_putchar(game, '\n');
 }
 
 
 /* display items in inventory */
-extern void list_inv(void)
+extern void list_inv(struct game *game)
 {
+	const struct item *items = game->world->items;
 	int i;
 	int count;
 
-	printf("\nInventory:\n");
-	for (count = 0, i = 0; items[i].item_id != -1; i++) {
-		if (inventory[i] == YES) {
-			count++;
-			putchar('\t');
-			if (items[i].item_adj != NULL)
-				printf("%s ",items[i].item_adj);
-			printf("%s\n",items[i].item_name);
-		}
+	game_printf(game, "\nInventory:\n");
+	for (count = 0, i = inventory_first(game); i != -1; i = inventory_next(game, i)) {
+		count++;
+		game_putchar(game, '\t');
+		if (items[i].item_adj != 0)
+			game_printf(game, "%s ",world_string(game->world, items[i].item_adj));
+		game_printf(game, "%s\n",world_string(game->world, items[i].item_name));
 	}
 	if (count == 0)
-		printf("\tnothing.\n");
+		game_printf(game, "\tnothing.\n");
 }
 
 /* in inventory */
-static int in_room(int room_id, char *adj, char *name)
+static int in_room(struct game *game, int room_id, const struct word *adj, const struct word *name)
 {
+	const struct world *world = game->world;
 	int i;
+	int k;
 	int item_num;
 	int count;
+	int name_token;
+	int adj_token;
+
+	/* words no item uses can't match */
+	if ((name_token = name->token) == -1)
+		return -1;
+	if (adj != NULL && (adj_token = adj->token) == -1)
+		return -1;
 
 	/* find out if given name is ambiguous */
-	for (count = 0, i = 0; items[i].item_id != -1; i++) {
-		if (strcmp(items[i].item_name,name) == 0 &&
-			items[i].location == room_id && items[i].hidden == NO) {
+	for (count = 0, k = world->name_start[name_token]; k < world->name_start[name_token + 1]; k++) {
+		i = world->name_items[k];
+		if (item_location(game, i) == room_id && !item_hidden(game, i)) {
 			if (adj == NULL) {
 				count++;
 				item_num = i;
-			} else if (items[i].item_adj != NULL &&
-					strcmp(adj,items[i].item_adj) == 0) {
+			} else if (world->item_adj[i] == adj_token) {
 				count = 1;
 				item_num = i;
 				break;
 			}
 		}
 	}
+	METRIC_ADD(game, items_scanned, k - world->name_start[name_token] +
+		(k < world->name_start[name_token + 1]));
 
 	/* return results */
-	if (count == 0) {
-		return -1;
-	} else if (count > 1) {
-		return -2;
-	} else {
-		return item_num;
-	}
+	if (count == 0)
+		item_num = -1;
+	else if (count > 1)
+		item_num = -2;
+	TRACE(game, TRACE_ITEM, item_num, room_id, name_token);
+	return item_num;
 }
 
 /* pick up item */
-extern void take_item(int room_id, char *word1, char *word2)
+extern void take_item(struct game *game, int room_id, const struct word *word1, const struct word *word2)
 {
-	char *adj;
-	char *name;
+	const struct item *items = game->world->items;
+	const struct word *adj;
+	const struct word *name;
 	int item_num;
 
-	putchar('\n');
+	game_putchar(game, '\n');
 
 	if (word1 == NULL) {
-		printf("Take what?\n");
+		game_printf(game, "Take what?\n");
 		return;
 	}
 	
@@ -138,79 +151,88 @@ extern void take_item(int room_id, char *word1, char *word2)
 	assign_name(&word1, &word2, &adj, &name);
 		
 	/* find out if given name is ambiguous */
-	item_num = in_room(room_id, adj, name);
+	item_num = in_room(game, room_id, adj, name);
 	
 	/* if none were found, the item is not present */
 	/* if only one was found, it's not ambiguous */
 	if (item_num == -1) {
-		printf("There is no ");
-		if (adj != NULL) printf("%s ",adj);
-		printf("%s here.\n",name);
+		game_printf(game, "There is no ");
+		if (adj != NULL) game_printf(game, "%s ",adj->text);
+		game_printf(game, "%s here.\n",name->text);
 		return;
 	} else if (item_num == -2) {
-		printf("Which %s do you want to take?\n",name);
+		game_printf(game, "Which %s do you want to take?\n",name->text);
 		return;
 	}
 
 	/* take item if possible */
 	if (items[item_num].takeable == YES) {
-		items[item_num].location = -1;
-		inventory[item_num] = 1;
-		printf("You took the ");
-		if (items[item_num].item_adj != NULL)
-			printf("%s ",items[item_num].item_adj);
-		printf("%s.\n",name);
+		set_item_location(game, item_num, -1);
+		set_in_inventory(game, item_num, YES);
+		game_printf(game, "You took the ");
+		if (items[item_num].item_adj != 0)
+			game_printf(game, "%s ",world_string(game->world, items[item_num].item_adj));
+		game_printf(game, "%s.\n",name->text);
 	} else {
-		printf("You cannot take the %s!\n",name);
+		game_printf(game, "You cannot take the %s!\n",name->text);
 	}
 }
 
-extern void take(int item_id)
+extern void take(struct game *game, int item_id)
 {
-	inventory[item_id] = 1;
+	set_in_inventory(game, item_id, YES);
 }
 
-static int in_inv(char *adj, char *name)
+static int in_inv(struct game *game, const struct word *adj, const struct word *name)
 {
+	const struct world *world = game->world;
 	int i;
+	int k;
 	int item_num;
 	int count;
-	
+	int name_token;
+	int adj_token;
+
+	if ((name_token = name->token) == -1)
+		return -1;
+	if (adj != NULL && (adj_token = adj->token) == -1)
+		return -1;
+
 	/* find out if given name is ambiguous */
-	for (count = 0, i = 0; items[i].item_id != -1; i++) {
-		if (strcmp(items[i].item_name,name) == 0 &&
-			inventory[i] == YES) {
+	for (count = 0, k = world->name_start[name_token]; k < world->name_start[name_token + 1]; k++) {
+		i = world->name_items[k];
+		if (in_inventory(game, i)) {
 			if (adj == NULL) {
 				count++;
 				item_num = i;
-			} else if (items[i].item_adj != NULL &&
-				strcmp(adj,items[i].item_adj) == 0) {
+			} else if (world->item_adj[i] == adj_token) {
 				count = 1;
 				item_num = i;
 				break;
 			}
 		}
 	}
+	METRIC_ADD(game, items_scanned, k - world->name_start[name_token] +
+		(k < world->name_start[name_token + 1]));
 
 	/* return results */
-	if (count == 0) {
-		return -1;
-	} else if (count > 1) {
-		return -2;
-	} else {
-		return item_num;
-	}
+	if (count == 0)
+		item_num = -1;
+	else if (count > 1)
+		item_num = -2;
+	TRACE(game, TRACE_ITEM, item_num, -1, name_token);
+	return item_num;
 }
 
-extern int unique_item(int room_id, char *adj, char *name)
+extern int unique_item(struct game *game, int room_id, const struct word *adj, const struct word *name)
 {
 	int room;
 	int inv;
 
 	if (name == NULL) return -1;
 
-	room = in_room(room_id, adj,name);
-	inv = in_inv(adj,name);
+	room = in_room(game, room_id, adj,name);
+	inv = in_inv(game, adj,name);
 
 	if ((room >= 0 && inv >= 0) || room == -2 || inv == -2) {
 		return -2;
@@ -223,16 +245,17 @@ extern int unique_item(int room_id, char *adj, char *name)
 }
 
 /* drop item */
-extern void drop_item(int room_id, char *word1, char *word2)
+extern void drop_item(struct game *game, int room_id, const struct word *word1, const struct word *word2)
 {
-	char *adj = NULL;
-	char *name = NULL;
+	const struct item *items = game->world->items;
+	const struct word *adj = NULL;
+	const struct word *name = NULL;
 	int item_num;
 
-	putchar('\n');
+	game_putchar(game, '\n');
 
 	if (word1 == NULL) {
-		printf("Drop what?\n");
+		game_printf(game, "Drop what?\n");
 		return;
 	}
 	
@@ -240,40 +263,41 @@ extern void drop_item(int room_id, char *word1, char *word2)
 	assign_name(&word1, &word2, &adj, &name);
 	
 	/* find out if given name is ambiguous */
-	item_num = in_inv(adj, name);
+	item_num = in_inv(game, adj, name);
 
 	/* if none were found, the item is not in inventory */
 	/* if only one was found, it's not ambiguous */
 	if (item_num == -1) {
-		printf("You do not have a ");
-		if (adj != NULL) printf("%s ",adj);
-		printf("%s.\n",name);
+		game_printf(game, "You do not have a ");
+		if (adj != NULL) game_printf(game, "%s ",adj->text);
+		game_printf(game, "%s.\n",name->text);
 		return;
 	} else if (item_num == -2) {
-		printf("Which %s do you want to drop?\n",name);
+		game_printf(game, "Which %s do you want to drop?\n",name->text);
 		return;
 	}
 
 	/* drop item */
-	items[item_num].location = room_id;
-	inventory[item_num] = NO;
-	printf("You dropped the ");
-	if (items[item_num].item_adj != NULL)
-		printf("%s ",items[item_num].item_adj);
-	printf("%s.\n",name);
+	set_item_location(game, item_num, room_id);
+	set_in_inventory(game, item_num, NO);
+	game_printf(game, "You dropped the ");
+	if (items[item_num].item_adj != 0)
+		game_printf(game, "%s ",world_string(game->world, items[item_num].item_adj));
+	game_printf(game, "%s.\n",name->text);
 }
 
 /* item in inventory? */
-extern void look_item(int room_id, char *word1, char *word2)
+extern void look_item(struct game *game, int room_id, const struct word *word1, const struct word *word2)
 {
-	char *adj = NULL;
-	char *name = NULL;
+	const struct item *items = game->world->items;
+	const struct word *adj = NULL;
+	const struct word *name = NULL;
 	int item_num;
 
-	putchar('\n');
+	game_putchar(game, '\n');
 
 	if (word1 == NULL) {
-		printf("Look at what?\n");
+		game_printf(game, "Look at what?\n");
 		return;
 	}
 	
@@ -281,30 +305,30 @@ extern void look_item(int room_id, char *word1, char *word2)
 	assign_name(&word1, &word2, &adj, &name);
 
 	/* in location or inventory? */
-	item_num = unique_item(room_id, adj, name);
+	item_num = unique_item(game, room_id, adj, name);
 
 	/* is it ambiguous? */
 	if (item_num == -2) {
-		printf("Which %s?\n",name);
+		game_printf(game, "Which %s?\n",name->text);
 		return;
 	} else if (item_num == -1) {
-		printf("There is no ");
-		if (adj != NULL) printf("%s ",adj);
-		printf("%s here.\n",name);
+		game_printf(game, "There is no ");
+		if (adj != NULL) game_printf(game, "%s ",adj->text);
+		game_printf(game, "%s here.\n",name->text);
 		return;
 	} 
 	/* output description */
-	printf("%s\n",items[item_num].item_desc_exam);
+	game_printf(game, "%s\n",world_string(game->world, items[item_num].item_desc_exam));
 }
 
-extern void break_item(int item_id)
+extern void break_item(struct game *game, int item_id)
 {
-	inventory[item_id] = 0;
-	items[item_id].location = -1;
+	set_in_inventory(game, item_id, NO);
+	set_item_location(game, item_id, -1);
 }
 
 
-extern void create_item(int item_id, int room_id)
+extern void create_item(struct game *game, int item_id, int room_id)
 {
-	items[item_id].location = room_id;
+	set_item_location(game, item_id, room_id);
 }
@@ -0,0 +1,355 @@
+#include <stdlib.h>
+#include <string.h>
+#include "journal.h"
+#include "state.h"
+struct delta;
+static int grow(void **array, size_t *size, size_t count, size_t item);
+static void apply(struct game *game, const struct delta *delta, int undo);
+static void move_to(struct game *game, size_t done);
+static struct journal *journal_new(struct game *game);
+static void trim(struct journal *journal);
+
+/* commands a game keeps for undo until game_journal() says otherwise */
+#define JOURNAL_COMMANDS 10000
+
+/* A journal of the changes made to a game, one delta per setter call that
+ * changed something, grouped by the command that made them. Undoing a
+ * command plays its deltas back through the setters with the old values,
+ * so the hash and the item lists follow, and costs as much as the command
+ * changed rather than as long as the game has been. It keeps at least the
+ * last limit commands: once it holds twice that, the older half is dropped,
+ * so a long batch or replay runs in bounded memory.
+ */
+struct delta {
+	int field;		/* F_*, see state.h */
+	int index;		/* item, event, or room * 4 + dir for exits */
+	int old;
+	int new;
+};
+
+struct checkpoint {
+	int n;
+	size_t done;
+};
+
+struct journal {
+	struct delta *deltas;	/* of the commands done, then those undone */
+	size_t delta_count;
+	size_t delta_size;
+	size_t *commands;	/* the first delta of each command */
+	size_t command_count;
+	size_t command_size;
+	size_t done;		/* commands done; the rest can be redone */
+	size_t pending;		/* first delta of the command being played */
+	uint64_t hash;		/* of the state before it */
+	struct checkpoint *checkpoints;
+	size_t checkpoint_count;
+	size_t checkpoint_size;
+	size_t limit;		/* commands kept, 0 for none */
+	int recording;		/* 1 once the current command changed something,
+				 * -1 if its changes could not be kept */
+	int replaying;		/* changes come from the journal itself */
+};
+
+/* Keep at least the last commands commands of a game for undo, or none for
+ * 0; the history starts over. Returns 0, or -1 if out of memory.
+ */
+extern int game_journal(struct game *game, size_t commands)
+{
+	struct journal *journal = game->journal;
+
+	if (journal == NULL && (journal = journal_new(game)) == NULL)
+		return -1;
+	journal_clear(game);
+	journal->limit = commands;
+	if (commands == 0) {
+		free(journal->deltas);
+		free(journal->commands);
+		free(journal->checkpoints);
+		journal->deltas = NULL;
+		journal->commands = NULL;
+		journal->checkpoints = NULL;
+		journal->delta_size = 0;
+		journal->command_size = 0;
+		journal->checkpoint_size = 0;
+	}
+	return 0;
+}
+
+static struct journal *journal_new(struct game *game)
+{
+	struct journal *journal;
+
+	if ((journal = calloc(1, sizeof(*journal))) == NULL)
+		return NULL;
+	journal->limit = JOURNAL_COMMANDS;
+	game->journal = journal;
+	return journal;
+}
+
+/* keep a change made by the command being played */
+extern void journal_record(struct game *game, int field, int index, int old, int new)
+{
+	struct journal *journal = game->journal;
+	struct delta *delta;
+
+	if (journal == NULL && (journal = journal_new(game)) == NULL)
+		return;
+	if (journal->replaying || journal->recording == -1 || journal->limit == 0)
+		return;
+
+	/* a command's changes go after those that can be redone, until
+	 * journal_end() knows whether they leave anything changed */
+	if (journal->recording == 0) {
+		journal->pending = journal->delta_count;
+		journal->hash = game->state->hash;
+		journal->recording = 1;
+	}
+	if (grow((void **)&journal->deltas, &journal->delta_size,
+		journal->delta_count, sizeof(*journal->deltas)))
+		goto lost;
+	delta = &journal->deltas[journal->delta_count++];
+	delta->field = field;
+	delta->index = index;
+	delta->old = old;
+	delta->new = new;
+	return;
+
+	/* out of memory: a command that is half kept can't be undone */
+lost:
+	journal_clear(game);
+	journal->recording = -1;
+}
+
+/* The command being played is over. If it changed something, it becomes
+ * the last command done, and the commands undone before it and the
+ * checkpoints after them are forgotten; if its changes cancel out, as when
+ * an event is turned off and on again, so the state's hash is what it was
+ * before, it is dropped and they are kept.
+ */
+extern void journal_end(struct game *game)
+{
+	struct journal *journal = game->journal;
+	size_t count;
+	size_t start;
+	size_t i;
+
+	if (journal == NULL)
+		return;
+	if (journal->recording != 1) {
+		journal->recording = 0;
+		return;
+	}
+	journal->recording = 0;
+	if (game->state->hash == journal->hash) {
+		journal->delta_count = journal->pending;
+		return;
+	}
+
+	count = journal->delta_count - journal->pending;
+	start = journal->done < journal->command_count ? journal->commands[journal->done] : journal->pending;
+	memmove(&journal->deltas[start], &journal->deltas[journal->pending], count * sizeof(*journal->deltas));
+	journal->delta_count = start + count;
+	journal->command_count = journal->done;
+	for (i = 0; i < journal->checkpoint_count; ) {
+		if (journal->checkpoints[i].done > journal->done)
+			journal->checkpoints[i] = journal->checkpoints[--journal->checkpoint_count];
+		else
+			i++;
+	}
+	if (grow((void **)&journal->commands, &journal->command_size,
+		journal->command_count, sizeof(*journal->commands))) {
+		journal_clear(game);
+		return;
+	}
+	journal->commands[journal->command_count++] = start;
+	journal->done = journal->command_count;
+	if (journal->command_count >= 2 * journal->limit)
+		trim(journal);
+}
+
+/* drop the oldest commands, all done, down to the last limit of them, and
+ * the checkpoints before them */
+static void trim(struct journal *journal)
+{
+	size_t drop = journal->command_count - journal->limit;
+	size_t first = journal->commands[drop];
+	size_t i;
+
+	memmove(journal->deltas, &journal->deltas[first],
+		(journal->delta_count - first) * sizeof(*journal->deltas));
+	journal->delta_count -= first;
+	for (i = 0; i < journal->limit; i++)
+		journal->commands[i] = journal->commands[i + drop] - first;
+	journal->command_count = journal->done = journal->limit;
+	for (i = 0; i < journal->checkpoint_count; ) {
+		if (journal->checkpoints[i].done < drop) {
+			journal->checkpoints[i] = journal->checkpoints[--journal->checkpoint_count];
+		} else {
+			journal->checkpoints[i].done -= drop;
+			i++;
+		}
+	}
+}
+
+/* forget everything, as when the state was replaced as a whole */
+extern void journal_clear(struct game *game)
+{
+	struct journal *journal = game->journal;
+
+	if (journal == NULL)
+		return;
+	journal->delta_count = 0;
+	journal->command_count = 0;
+	journal->done = 0;
+	journal->checkpoint_count = 0;
+	journal->pending = 0;
+	journal->recording = 0;
+}
+
+extern void journal_free(struct game *game)
+{
+	struct journal *journal = game->journal;
+
+	if (journal == NULL)
+		return;
+	free(journal->deltas);
+	free(journal->commands);
+	free(journal->checkpoints);
+	free(journal);
+	game->journal = NULL;
+}
+
+extern int game_undo(struct game *game)
+{
+	if (game->journal == NULL || game->journal->done == 0)
+		return -1;
+	move_to(game, game->journal->done - 1);
+	return 0;
+}
+
+extern int game_redo(struct game *game)
+{
+	if (game->journal == NULL || game->journal->done == game->journal->command_count)
+		return -1;
+	move_to(game, game->journal->done + 1);
+	return 0;
+}
+
+/* remember where the game is as checkpoint n, replacing an older one */
+extern int game_checkpoint(struct game *game, int n)
+{
+	struct journal *journal = game->journal;
+	size_t i;
+
+	if (journal == NULL && (journal = journal_new(game)) == NULL)
+		return -1;
+	if (journal->limit == 0)
+		return -1;
+	for (i = 0; i < journal->checkpoint_count; i++)
+		if (journal->checkpoints[i].n == n)
+			break;
+	if (i == journal->checkpoint_count) {
+		if (grow((void **)&journal->checkpoints, &journal->checkpoint_size,
+			journal->checkpoint_count, sizeof(*journal->checkpoints)))
+			return -1;
+		journal->checkpoint_count++;
+	}
+	journal->checkpoints[i].n = n;
+	journal->checkpoints[i].done = journal->done;
+	return 0;
+}
+
+extern int game_rollback(struct game *game, int n)
+{
+	size_t i;
+
+	if (game->journal == NULL)
+		return -1;
+	for (i = 0; i < game->journal->checkpoint_count; i++) {
+		if (game->journal->checkpoints[i].n == n) {
+			move_to(game, game->journal->checkpoints[i].done);
+			return 0;
+		}
+	}
+	return -1;
+}
+
+/* back to where the game started, or was last loaded, as far as the
+ * journal reaches */
+extern void game_restart(struct game *game)
+{
+	if (game->journal != NULL)
+		move_to(game, 0);
+}
+
+/* undo or redo commands until done of them are done */
+static void move_to(struct game *game, size_t done)
+{
+	struct journal *journal = game->journal;
+	size_t end;
+	size_t i;
+
+	journal->replaying = 1;
+	while (journal->done > done) {
+		journal->done--;
+		end = journal->done + 1 < journal->command_count ?
+			journal->commands[journal->done + 1] : journal->delta_count;
+		for (i = end; i > journal->commands[journal->done]; i--)
+			apply(game, &journal->deltas[i - 1], 1);
+	}
+	while (journal->done < done) {
+		end = journal->done + 1 < journal->command_count ?
+			journal->commands[journal->done + 1] : journal->delta_count;
+		for (i = journal->commands[journal->done]; i < end; i++)
+			apply(game, &journal->deltas[i], 0);
+		journal->done++;
+	}
+	journal->replaying = 0;
+}
+
+/* make a change again, or take it back */
+static void apply(struct game *game, const struct delta *delta, int undo)
+{
+	int value = undo ? delta->old : delta->new;
+
+	switch (delta->field) {
+	case F_ROOM:
+		set_room(game, value);
+		break;
+	case F_STATUS:
+		set_status(game, value);
+		break;
+	case F_HIDDEN:
+		set_item_hidden(game, delta->index, value);
+		break;
+	case F_INVENTORY:
+		set_in_inventory(game, delta->index, value);
+		break;
+	case F_TRIGGERABLE:
+		set_event_triggerable(game, delta->index, value);
+		break;
+	case F_LOCATION:
+		set_item_location(game, delta->index, value);
+		break;
+	case F_EXIT:
+		set_room_exit(game, delta->index / 4, delta->index % 4, value);
+		break;
+	}
+}
+
+/* make room in an array for one more item, doubling it */
+static int grow(void **array, size_t *size, size_t count, size_t item)
+{
+	size_t new_size;
+	void *grown;
+
+	if (count < *size)
+		return 0;
+	new_size = *size ? *size * 2 : 64;
+	if ((grown = realloc(*array, new_size * item)) == NULL)
+		return 1;
+	*array = grown;
+	*size = new_size;
+	return 0;
+}
@@ -0,0 +1,11 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "game.h"
+
+extern void journal_record(struct game *game, int field, int index, int old, int new);
+extern void journal_end(struct game *game);
+extern void journal_clear(struct game *game);
+extern void journal_free(struct game *game);
+
+#endif
@@ -1,15 +1,285 @@
 #include <stdio.h>
-#include "input.h"
-int main(void);
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include "forest.h"
+int main(int argc, char *argv[]);
+static int batch(struct game *game, FILE *in, int quiet, struct recording *recording);
+static int replay(struct game *game, const char *path);
+static void dump_metrics(struct game *game, const char *path);
+static int start_trace(struct game *game, const char *path);
+static void dump_trace(int sig);
 static void splash_screen(void);
+static char *readline(FILE *in);
 
-int main(void)
+/* exit status when forest cannot start; batch and machine games end with
+ * 0 to 3 */
+#define EXIT_ERROR 4
+
+/* records kept by --trace */
+#define TRACE_RECORDS 65536
+
+/* the game being traced and where its trace goes, for dump_trace() */
+static struct game *traced;
+static int trace_fd = -1;
+
+int main(int argc, char *argv[])
+{
+	const struct world *world = NULL;
+	const char *script = NULL;
+	const char *saved = NULL;
+	const char *record = NULL;
+	const char *recorded = NULL;
+	const char *metrics = NULL;
+	const char *trace = NULL;
+	struct recording *recording = NULL;
+	struct game *game;
+	struct game_output out = {.sink = OUTPUT_FD, .fd = STDOUT_FILENO, .prompt = "\ncommand> "};
+	FILE *in = stdin;
+	char *line;
+	int quiet = 0;
+	int machine = 0;
+	int status;
+	int i;
+
+	/* forest [--load file] [--batch file | --replay file] [--record file]
+	 *	[--metrics file] [--trace file] [--quiet | --machine] [world image] */
+	for (i = 1; i < argc && argv[i][0] == '-' && argv[i][1] != '\0'; i++) {
+		if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+			script = argv[++i];
+		} else if (strcmp(argv[i], "--load") == 0 && i + 1 < argc) {
+			saved = argv[++i];
+		} else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+			record = argv[++i];
+		} else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+			recorded = argv[++i];
+		} else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+			metrics = argv[++i];
+		} else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+			trace = argv[++i];
+		} else if (strcmp(argv[i], "--quiet") == 0) {
+			quiet = 1;
+		} else if (strcmp(argv[i], "--machine") == 0) {
+			machine = 1;
+		} else {
+			break;
+		}
+	}
+	if (argc - i > 1 || (i < argc && argv[i][0] == '-') || (quiet && machine) ||
+		(recorded != NULL && (script != NULL || record != NULL))) {
+		fprintf(stderr, "usage: forest [--load file] [--batch file | --replay file] [--record file]\n"
+			"\t[--metrics file] [--trace file] [--quiet | --machine] [world]\n");
+		return EXIT_ERROR;
+	}
+	if (quiet && script == NULL)
+		script = "-";
+	if (i < argc && (world = world_load(argv[i])) == NULL) {
+		fprintf(stderr, "forest: %s: %s\n", argv[i],
+			errno == EINVAL ? "not a world image" : strerror(errno));
+		return EXIT_ERROR;
+	}
+	if (script != NULL && strcmp(script, "-") != 0 && (in = fopen(script, "r")) == NULL) {
+		fprintf(stderr, "forest: %s: %s\n", script, strerror(errno));
+		return EXIT_ERROR;
+	}
+	if ((game = world != NULL ? game_new_world(world) : game_new()) == NULL) {
+		fprintf(stderr, "forest: out of memory\n");
+		return EXIT_ERROR;
+	}
+	if (saved != NULL && game_load(game, saved) == -1) {
+		fprintf(stderr, "forest: %s: %s\n", saved,
+			errno == EINVAL ? "not a saved game of this world" : strerror(errno));
+		return EXIT_ERROR;
+	}
+	if (metrics != NULL && game_metrics(game, 1) == -1) {
+		fprintf(stderr, "forest: metrics: %s\n", strerror(errno));
+		return EXIT_ERROR;
+	}
+	if (trace != NULL && start_trace(game, trace) == -1) {
+		fprintf(stderr, "forest: %s: %s\n", trace, strerror(errno));
+		return EXIT_ERROR;
+	}
+	if (recorded != NULL) {
+		status = replay(game, recorded);
+		if (metrics != NULL)
+			dump_metrics(game, metrics);
+		if (trace != NULL)
+			dump_trace(0);
+		game_free(game);
+		world_unload(world);
+		return status;
+	}
+	if (record != NULL && (recording = recording_new(game, record)) == NULL) {
+		fprintf(stderr, "forest: %s: %s\n", record, strerror(errno));
+		return EXIT_ERROR;
+	}
+
+	if (script != NULL && !machine) {
+		status = batch(game, in, quiet, recording);
+	} else {
+		/* harnesses get a frame per response, starting with the first room */
+		if (machine) {
+			out.prompt = NULL;
+			out.framed = 1;
+		} else {
+			splash_screen();
+			fflush(stdout);
+		}
+
+		/* Start in room 0 and show it; each response ends with the prompt */
+		status = game_step(game, "look", &out);
+
+		/* main input loop */
+		while(status == 0 && out.error == 0 && (line = readline(in)) != NULL) {
+			status = game_step(game, line, &out);
+			if (recording != NULL)
+				recording_add(recording, game, line);
+		}
+		free(out.text);
+		if (!machine && script == NULL)
+			status = 0;
+	}
+
+	if (in != stdin)
+		fclose(in);
+	if (recording_free(recording) == -1)
+		fprintf(stderr, "forest: %s: %s\n", record, strerror(errno));
+	if (metrics != NULL)
+		dump_metrics(game, metrics);
+	if (trace != NULL)
+		dump_trace(0);
+	game_free(game);
+	world_unload(world);
+	return -status;
+}
+
+/* Fast-forward through a recording, checking every response, and say how
+ * far it got. Returns the exit status: 0 if all of it matched.
+ */
+static int replay(struct game *game, const char *path)
 {
-	splash_screen();
-	input_loop();
+	long played;
+	int diverged;
+
+	if ((played = game_replay(game, path, &diverged)) == -1) {
+		fprintf(stderr, "forest: %s: %s\n", path,
+			errno == EINVAL ? "not a recording of this world" : strerror(errno));
+		return EXIT_ERROR;
+	}
+	if (diverged) {
+		fprintf(stderr, "forest: %s: command %ld diverged\n", path, played + 1);
+		return 1;
+	}
+	printf("forest: %s: %ld commands replayed\n", path, played);
 	return 0;
 }
 
+/* write the game's metrics to path as JSON, or to standard error for "-" */
+static void dump_metrics(struct game *game, const char *path)
+{
+	struct game_output out = {NULL, 0, 0};
+	FILE *file = stderr;
+
+	game_metrics_json(game, &out);
+	if (strcmp(path, "-") != 0 && (file = fopen(path, "w")) == NULL) {
+		fprintf(stderr, "forest: %s: %s\n", path, strerror(errno));
+	} else {
+		fwrite(out.text, 1, out.len, file);
+		if (file != stderr && fclose(file) == EOF)
+			fprintf(stderr, "forest: %s: %s\n", path, strerror(errno));
+	}
+	free(out.text);
+}
+
+/* Trace the game into a file that holds the latest dump of it: at exit,
+ * on SIGUSR1, and when forest crashes.
+ */
+static int start_trace(struct game *game, const char *path)
+{
+	static const int crashes[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+	struct sigaction sa;
+	size_t i;
+
+	if ((trace_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) == -1)
+		return -1;
+	if (game_trace(game, TRACE_RECORDS) == -1)
+		return -1;
+	traced = game;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = dump_trace;
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = SA_RESTART;
+	sigaction(SIGUSR1, &sa, NULL);
+
+	/* dump once, then let the signal kill forest as it would have */
+	sa.sa_flags = SA_RESETHAND;
+	for (i = 0; i < sizeof(crashes) / sizeof(*crashes); i++)
+		sigaction(crashes[i], &sa, NULL);
+	return 0;
+}
+
+/* write the trace over the last dump, or after it if the file is a pipe */
+static void dump_trace(int sig)
+{
+	int saved = errno;
+
+	if (lseek(trace_fd, 0, SEEK_SET) == 0)
+		ftruncate(trace_fd, 0);
+	game_trace_dump(traced, trace_fd);
+	errno = saved;
+}
+
+/* Play every command of a script, with no splash screen, prompts or
+ * flushing in between; quiet only shows the ending, or where the player
+ * stands if the script ends first. Returns the game's status.
+ */
+static int batch(struct game *game, FILE *in, int quiet, struct recording *recording)
+{
+	static char buffer[1 << 16];
+	struct game_output out = {NULL, 0, 0};
+	char *line;
+	int status = 0;
+
+	setvbuf(stdout, buffer, _IOFBF, sizeof(buffer));
+	while (status == 0 && (line = readline(in)) != NULL) {
+		out.len = 0;
+		status = game_step(game, line, &out);
+		if (recording != NULL)
+			recording_add(recording, game, line);
+		if (!quiet)
+			fwrite(out.text, 1, out.len, stdout);
+	}
+	if (quiet) {
+		if (status == 0) {
+			out.len = 0;
+			game_step(game, "look", &out);
+		}
+		fwrite(out.text, 1, out.len, stdout);
+	}
+	fflush(stdout);
+	free(out.text);
+	return status;
+}
+
+/* read a line of any length into a buffer that is reused for the next one */
+static char *readline(FILE *in)
+{
+	static char *buf = NULL;
+	static size_t size = 0;
+	ssize_t len;
+
+	if ((len = getline(&buf,&size,in)) == -1) return NULL;
+	while(len && (buf[len-1] == '\n' || buf[len-1] == '\r')) {
+		len--;
+		buf[len] = '\0';
+	}
+	return buf;
+}
+
 void splash_screen(void)
 {
 	printf("\n--------------------------------------------------------------------------------\n");
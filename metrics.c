@@ -0,0 +1,170 @@
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include "metrics.h"
+static uint64_t now(void);
+static int bucket(uint64_t ns);
+static uint64_t bucket_floor(int b);
+static uint64_t percentile(const struct verb_metrics *verb, int p);
+
+/* Turn a game's metrics on, from zero, or off. Returns 0, or -1 and errno
+ * (ENOSYS: built without them).
+ */
+extern int game_metrics(struct game *game, int on)
+{
+#ifdef NO_METRICS
+	errno = ENOSYS;
+	return on ? -1 : 0;
+#else
+	free(game->metrics);
+	game->metrics = NULL;
+	if (on && (game->metrics = calloc(1, sizeof(*game->metrics))) == NULL)
+		return -1;
+	return 0;
+#endif
+}
+
+/* a command is about to be played */
+extern void metrics_start(struct game *game)
+{
+	game->metrics->start_len = game->out->len;
+	game->metrics->start = now();
+}
+
+/* it was played, as the verb in this slot of verb_table */
+extern void metrics_verb(struct game *game, int slot, const char *word)
+{
+	struct metrics *metrics = game->metrics;
+	struct verb_metrics *verb = &metrics->verbs[slot];
+	uint64_t ns = now() - metrics->start;
+
+	metrics->commands++;
+	verb->word = word;
+	verb->count++;
+	verb->ns += ns;
+	verb->bytes += game->out->len - metrics->start_len;
+	verb->buckets[bucket(ns)]++;
+}
+
+/* the stats command */
+extern void metrics_print(struct game *game)
+{
+	const struct metrics *metrics = game->metrics;
+	const struct verb_metrics *verb;
+	int i;
+
+	if (metrics == NULL) {
+#ifdef NO_METRICS
+		game_printf(game, "\nThis forest was built without metrics.\n");
+#else
+		game_printf(game, "\nNo metrics are being kept; start forest with --metrics.\n");
+#endif
+		return;
+	}
+	game_printf(game, "\n%llu commands, %llu items and %llu events scanned\n\n",
+		(unsigned long long)metrics->commands,
+		(unsigned long long)metrics->items_scanned,
+		(unsigned long long)metrics->events_scanned);
+	game_printf(game, "%-12s %8s %10s %10s %10s %10s\n",
+		"verb", "count", "mean ns", "p50 ns", "p99 ns", "bytes");
+	for (i = 0; i <= METRIC_VERBS; i++) {
+		verb = &metrics->verbs[i];
+		if (verb->count == 0)
+			continue;
+		game_printf(game, "%-12s %8llu %10llu %10llu %10llu %10llu\n", verb->word,
+			(unsigned long long)verb->count,
+			(unsigned long long)(verb->ns / verb->count),
+			(unsigned long long)percentile(verb, 50),
+			(unsigned long long)percentile(verb, 99),
+			(unsigned long long)verb->bytes);
+	}
+}
+
+/* Append a game's metrics to out as one JSON object: the totals, and for
+ * each verb used its count, time and output, and its latency histogram as
+ * [lowest ns, count] pairs of the buckets that are not empty.
+ */
+extern void game_metrics_json(struct game *game, struct game_output *out)
+{
+	const struct metrics *metrics = game->metrics;
+	const struct verb_metrics *verb;
+	struct game_output *saved = game->out;
+	const char *sep = "";
+	int i;
+	int b;
+
+	game->out = out;
+	if (metrics == NULL) {
+		game_printf(game, "{}\n");
+		game->out = saved;
+		return;
+	}
+	game_printf(game, "{\"commands\":%llu,\"items_scanned\":%llu,\"events_scanned\":%llu,\"verbs\":{",
+		(unsigned long long)metrics->commands,
+		(unsigned long long)metrics->items_scanned,
+		(unsigned long long)metrics->events_scanned);
+	for (i = 0; i <= METRIC_VERBS; i++) {
+		verb = &metrics->verbs[i];
+		if (verb->count == 0)
+			continue;
+		game_printf(game, "%s\n\"%s\":{\"count\":%llu,\"ns\":%llu,\"bytes\":%llu,\"latency\":[",
+			sep, verb->word, (unsigned long long)verb->count,
+			(unsigned long long)verb->ns, (unsigned long long)verb->bytes);
+		sep = "";
+		for (b = 0; b < METRIC_BUCKETS; b++) {
+			if (verb->buckets[b] == 0)
+				continue;
+			game_printf(game, "%s[%llu,%llu]", sep, (unsigned long long)bucket_floor(b),
+				(unsigned long long)verb->buckets[b]);
+			sep = ",";
+		}
+		game_printf(game, "]}");
+		sep = ",";
+	}
+	game_printf(game, "}}\n");
+	game->out = saved;
+}
+
+static uint64_t now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Log-linear: below 4 ns one bucket each, then each power of two split
+ * into 4, so a bucket is never wider than a quarter of what it holds.
+ * Anything from 2^33 ns on goes in the last one.
+ */
+static int bucket(uint64_t ns)
+{
+	int e;
+
+	if (ns < 4)
+		return ns;
+	if ((e = 63 - __builtin_clzll(ns)) > 32)
+		return METRIC_BUCKETS - 1;
+	return (e - 1) * 4 + (ns >> (e - 2) & 3);
+}
+
+static uint64_t bucket_floor(int b)
+{
+	if (b < 4)
+		return b;
+	return (uint64_t)(4 + b % 4) << (b / 4 - 1);
+}
+
+/* the bucket the p-th percentile of a verb's latencies falls in */
+static uint64_t percentile(const struct verb_metrics *verb, int p)
+{
+	uint64_t seen = 0;
+	int b;
+
+	for (b = 0; b < METRIC_BUCKETS - 1; b++) {
+		seen += verb->buckets[b];
+		if (seen * 100 >= verb->count * p)
+			break;
+	}
+	return bucket_floor(b);
+}
@@ -0,0 +1,54 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "game.h"
+
+/* Counters kept while a game is played, once game_metrics() turns them on
+ * (see metrics.c). Building with -DNO_METRICS takes them out altogether;
+ * otherwise a game without them pays one test of game->metrics at each
+ * place that counts.
+ */
+#define METRIC_VERBS 64		/* slots of verb_table; the one after is for unknown words */
+#define METRIC_BUCKETS 128	/* 4 per power of two of nanoseconds, up to 2^33 */
+
+struct verb_metrics {
+	const char *word;
+	uint64_t count;
+	uint64_t ns;
+	uint64_t bytes;		/* of output */
+	uint64_t buckets[METRIC_BUCKETS];
+};
+
+struct metrics {
+	uint64_t commands;
+	uint64_t items_scanned;		/* by in_room() and in_inv() */
+	uint64_t events_scanned;	/* by interact() */
+	uint64_t start;			/* of the command being timed */
+	size_t start_len;		/* of the output before it */
+	struct verb_metrics verbs[METRIC_VERBS + 1];
+};
+
+#ifdef NO_METRICS
+#define METRIC_ADD(game, counter, n) ((void)0)
+#define METRIC_START(game) ((void)0)
+#define METRIC_VERB(game, slot, word) ((void)0)
+#else
+#define METRIC_ADD(game, counter, n) do { \
+	if ((game)->metrics != NULL) \
+		(game)->metrics->counter += (n); \
+} while (0)
+#define METRIC_START(game) do { \
+	if ((game)->metrics != NULL) \
+		metrics_start(game); \
+} while (0)
+#define METRIC_VERB(game, slot, word) do { \
+	if ((game)->metrics != NULL) \
+		metrics_verb(game, slot, word); \
+} while (0)
+#endif
+
+extern void metrics_start(struct game *game);
+extern void metrics_verb(struct game *game, int slot, const char *word);
+extern void metrics_print(struct game *game);
+
+#endif
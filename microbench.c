@@ -0,0 +1,347 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+#include "game.h"
+#include "world.h"
+#include "state.h"
+struct bench;
+int main(int argc, char *argv[]);
+static void setup_room(struct game *game);
+static void setup_chain(struct game *game);
+static void pick(const struct world *world);
+static const char *phrase(const struct world *world, int item);
+static void run(const struct world *world, const struct bench *bench);
+static uint64_t now(void);
+static int counters_open(void);
+static void counters_read(uint64_t values[3]);
+
+/* microbench - time the engine's hot paths, one command at a time
+ *
+ *	microbench [-p] [-v] [-r runs] [world image]
+ *
+ * Each benchmark starts a game of the world (the built-in one by default),
+ * puts it in a state where playing its command over and over finds the
+ * same things and changes nothing, and plays it into a null sink in runs
+ * long enough to time, after one run to warm up. It prints the mean time
+ * of a command over the runs, their standard deviation and the fastest
+ * run, and with -p the cycles, instructions and cache misses per command
+ * that perf_event_open() counts in user space. -v shows each command and
+ * what it answers, to check it does what the benchmark says.
+ */
+
+struct bench {
+	const char *name;
+	const char *what;
+	void (*setup)(struct game *game);
+	const char *command;	/* or the phrase picked, with %s */
+	int item;		/* 0 or 1: which phrase */
+	int memory;		/* into a memory sink, to count the formatting */
+};
+
+/* what the benchmarks work on, picked from the world by pick() */
+static int busy_room;		/* the room with the most items */
+static int looked_item;		/* there, of the longest name list */
+static int chain;		/* the longest chain of events */
+
+static const struct bench benches[] = {
+	{"unknown", "tokenize, look up a verb that is not there",
+		NULL, "xyzzy plugh frobozz", 0, 0},
+	{"dispatch", "tokenize, look up and call inventory",
+		NULL, "inventory", 0, 0},
+	{"look-item", "unique_item(): in_room() and in_inv() on a long name list",
+		setup_room, "look %s", 0, 0},
+	{"drop-missing", "in_inv() missing on a long name list",
+		setup_room, "drop %s", 0, 0},
+	{"interact", "unique_item() and interact() down the longest chain",
+		setup_chain, "use %s", 1, 0},
+	{"look", "look_room() in the busiest room",
+		setup_room, "look", 0, 0},
+	{"look-render", "look_room() in the busiest room, formatted",
+		setup_room, "look", 0, 1},
+	{"search", "search() in the busiest room",
+		setup_room, "search", 0, 0},
+};
+
+static int runs = 11;
+static int verbose;
+static int counters = -1;	/* perf event group, or -1 */
+static char use_phrase[256];	/* of the items the longest chain uses */
+
+int main(int argc, char *argv[])
+{
+	const struct world *world;
+	size_t i;
+	int c;
+
+	while ((c = getopt(argc, argv, "pvr:")) != -1) {
+		switch (c) {
+		case 'p':
+			if ((counters = counters_open()) == -1)
+				fprintf(stderr, "microbench: no perf counters: %s\n", strerror(errno));
+			break;
+		case 'r':
+			runs = atoi(optarg);
+			break;
+		case 'v':
+			verbose = 1;
+			break;
+		default:
+			goto usage;
+		}
+	}
+	if (argc - optind > 1 || runs < 2)
+		goto usage;
+	if (optind < argc) {
+		if ((world = world_load(argv[optind])) == NULL) {
+			fprintf(stderr, "microbench: %s: %s\n", argv[optind],
+				errno == EINVAL ? "not a world image" : strerror(errno));
+			return 1;
+		}
+	} else if ((world = world_builtin()) == NULL) {
+		fprintf(stderr, "microbench: out of memory\n");
+		return 1;
+	}
+
+	pick(world);
+	printf("# %s: %d rooms, %d items, %d events\n",
+		optind < argc ? argv[optind] : "built-in world",
+		world->room_count, world->item_count, world->event_count);
+	printf("%-13s %9s %8s %9s", "benchmark", "ns/op", "+-sd", "min");
+	if (counters != -1)
+		printf(" %9s %9s %9s", "cycles", "instrs", "misses");
+	printf("   what\n");
+	for (i = 0; i < sizeof(benches) / sizeof(*benches); i++)
+		run(world, &benches[i]);
+	if (optind < argc)
+		world_unload(world);
+	return 0;
+
+usage:
+	fprintf(stderr, "usage: microbench [-p] [-v] [-r runs] [world image]\n");
+	return 1;
+}
+
+/* the room with the most items, and among them the item whose name the
+ * most items share; the chain with the most events */
+static void pick(const struct world *world)
+{
+	int *count = calloc(world->room_count, sizeof(int));
+	int longest = -1;
+	int i;
+	int t;
+	int k;
+
+	for (i = 0; i < world->item_count; i++)
+		if (world->items[i].location >= 0)
+			count[world->items[i].location]++;
+	for (i = 0; i < world->room_count; i++)
+		if (count[i] > count[busy_room])
+			busy_room = i;
+	free(count);
+
+	looked_item = -1;
+	for (t = 0; t < world->word_count; t++) {
+		for (k = world->name_start[t]; k < world->name_start[t + 1]; k++) {
+			i = world->name_items[k];
+			if (world->items[i].location == busy_room &&
+				world->name_start[t + 1] - world->name_start[t] > longest) {
+				longest = world->name_start[t + 1] - world->name_start[t];
+				looked_item = i;
+			}
+		}
+	}
+
+	chain = 0;
+	for (i = 1; i < world->chain_count; i++)
+		if (world->chains[i].count > world->chains[chain].count)
+			chain = i;
+	if (world->chain_count > 0) {
+		snprintf(use_phrase, sizeof(use_phrase), "%s", phrase(world, world->chains[chain].item1));
+		if (world->chains[chain].item2 != -1)
+			snprintf(use_phrase + strlen(use_phrase), sizeof(use_phrase) - strlen(use_phrase),
+				" %s", phrase(world, world->chains[chain].item2));
+	}
+}
+
+/* the words naming an item */
+static const char *phrase(const struct world *world, int item)
+{
+	static char text[128];
+	const struct item *it = &world->items[item];
+
+	if (it->item_adj != 0)
+		snprintf(text, sizeof(text), "%s %s", world_string(world, it->item_adj),
+			world_string(world, it->item_name));
+	else
+		snprintf(text, sizeof(text), "%s", world_string(world, it->item_name));
+	return text;
+}
+
+static void setup_room(struct game *game)
+{
+	set_room(game, busy_room);
+}
+
+/* at the longest chain with its items in hand, and none of its events
+ * able to fire, so every use walks all of it */
+static void setup_chain(struct game *game)
+{
+	const struct world *world = game->world;
+	const struct chain *c = &world->chains[chain];
+	int j;
+
+	set_room(game, c->room);
+	set_item_location(game, c->item1, -1);
+	set_in_inventory(game, c->item1, YES);
+	if (c->item2 != -1) {
+		set_item_location(game, c->item2, -1);
+		set_in_inventory(game, c->item2, YES);
+	}
+	for (j = 0; j < c->count; j++)
+		set_event_triggerable(game, world->chain_events[c->first + j], NO);
+}
+
+static void run(const struct world *world, const struct bench *bench)
+{
+	struct game_output out = {.sink = bench->memory ? OUTPUT_MEMORY : OUTPUT_NULL};
+	struct game *game;
+	char command[512];
+	double ns[runs];
+	double mean = 0;
+	double var = 0;
+	double best = 0;
+	uint64_t before[3];
+	uint64_t after[3];
+	uint64_t events[3] = {0, 0, 0};
+	uint64_t start;
+	long ops;
+	long n;
+	int r;
+	int i;
+
+	/* a world may have no items in rooms, or no events */
+	if (strstr(bench->command, "%s") == NULL) {
+		snprintf(command, sizeof(command), "%s", bench->command);
+	} else if (bench->item ? world->chain_count == 0 : looked_item == -1) {
+		printf("%-13s %9s\n", bench->name, "-");
+		return;
+	} else {
+		snprintf(command, sizeof(command), bench->command,
+			bench->item ? use_phrase : phrase(world, looked_item));
+	}
+	if ((game = game_new_world(world)) == NULL) {
+		fprintf(stderr, "microbench: out of memory\n");
+		exit(1);
+	}
+	if (bench->setup != NULL)
+		bench->setup(game);
+	if (verbose) {
+		struct game_output shown = {NULL, 0, 0};
+
+		game_step(game, command, &shown);
+		printf("> %s%s\n", command, shown.text != NULL ? shown.text : "\n");
+		free(shown.text);
+	}
+
+	/* as many commands as take 20ms; the first run of them warms up */
+	for (ops = 64; ; ops *= 2) {
+		start = now();
+		for (n = 0; n < ops; n++) {
+			out.len = 0;
+			game_step(game, command, &out);
+		}
+		if (now() - start > 20000000)
+			break;
+	}
+	for (r = 0; r < runs; r++) {
+		counters_read(before);
+		start = now();
+		for (n = 0; n < ops; n++) {
+			out.len = 0;
+			game_step(game, command, &out);
+		}
+		ns[r] = (double)(now() - start) / ops;
+		counters_read(after);
+		for (i = 0; i < 3; i++)
+			events[i] += after[i] - before[i];
+		mean += ns[r] / runs;
+		if (r == 0 || ns[r] < best)
+			best = ns[r];
+	}
+	for (r = 0; r < runs; r++)
+		var += (ns[r] - mean) * (ns[r] - mean) / (runs - 1);
+
+	printf("%-13s %9.1f %7.1f%% %9.1f", bench->name, mean, 100 * sqrt(var) / mean, best);
+	if (counters != -1)
+		for (i = 0; i < 3; i++)
+			printf(" %9.1f", (double)events[i] / ((double)ops * runs));
+	printf("   %s\n", bench->what);
+	game_free(game);
+	free(out.text);
+}
+
+static uint64_t now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* cycles, instructions and cache misses of this process in user space, as
+ * one group so they are counted over the same time */
+static int counters_open(void)
+{
+#ifdef __linux__
+	static const uint64_t configs[3] = {
+		PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES,
+	};
+	struct perf_event_attr attr;
+	int fds[3];
+	int error;
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = configs[i];
+		attr.disabled = i == 0;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_GROUP;
+		if ((fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, i == 0 ? -1 : fds[0], 0)) == -1) {
+			error = errno;
+			while (i > 0)
+				close(fds[--i]);
+			errno = error;
+			return -1;
+		}
+	}
+	ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	return fds[0];
+#else
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+static void counters_read(uint64_t values[3])
+{
+	uint64_t group[4];	/* the count, then the values */
+
+	if (counters == -1 || read(counters, group, sizeof(group)) != sizeof(group)) {
+		memset(values, 0, 3 * sizeof(uint64_t));
+		return;
+	}
+	memcpy(values, group + 1, 3 * sizeof(uint64_t));
+}
@@ -0,0 +1,133 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+int main(int argc, char *argv[]);
+static unsigned hash(const char *word, unsigned seed);
+static int try_seed(unsigned seed, unsigned mask);
+
+/* mkhash - build a perfect hash table from a word list
+ *
+ *	mkhash name < list > name.h
+ *
+ * Each line of the list is a word followed by the fields of its entry;
+ * blank lines and lines starting with # are skipped. The header declares
+ * name_table[], indexed by a hash that no two words share, and
+ * name_lookup(word), which returns the word's entry or NULL. The file
+ * including it defines struct name, starting with const char *word.
+ */
+
+#define MAX_WORDS 256
+#define MAX_LINE 256
+
+static char *words[MAX_WORDS];
+static char *fields[MAX_WORDS];
+static int count;
+static int slot[MAX_WORDS * 4];
+
+int main(int argc, char *argv[])
+{
+	char line[MAX_LINE];
+	char *p;
+	char *q;
+	unsigned mask;
+	unsigned seed;
+	int lineno;
+	int i;
+
+	if (argc != 2) {
+		fprintf(stderr, "usage: mkhash name < list > name.h\n");
+		return 1;
+	}
+
+	/* read "word field field..." and turn the fields into "field, field" */
+	for (lineno = 1; fgets(line, sizeof(line), stdin) != NULL; lineno++) {
+		for (p = line; isspace((unsigned char)*p); p++)
+			;
+		if (*p == '\0' || *p == '#')
+			continue;
+		if (count == MAX_WORDS) {
+			fprintf(stderr, "mkhash: more than %d words\n", MAX_WORDS);
+			return 1;
+		}
+		for (q = p; *q != '\0' && !isspace((unsigned char)*q); q++)
+			;
+		words[count] = strndup(p, q - p);
+		fields[count] = malloc(strlen(q) * 2 + 1);
+		if (words[count] == NULL || fields[count] == NULL) {
+			fprintf(stderr, "mkhash: out of memory\n");
+			return 1;
+		}
+		fields[count][0] = '\0';
+		for (p = q; *p != '\0'; p = q) {
+			while (isspace((unsigned char)*p))
+				p++;
+			for (q = p; *q != '\0' && !isspace((unsigned char)*q); q++)
+				;
+			if (q > p)
+				sprintf(fields[count] + strlen(fields[count]), ", %.*s", (int)(q - p), p);
+		}
+		for (i = 0; i < count; i++) {
+			if (strcmp(words[i], words[count]) == 0) {
+				fprintf(stderr, "mkhash: line %d: %s listed twice\n", lineno, words[count]);
+				return 1;
+			}
+		}
+		count++;
+	}
+
+	/* the smallest table, then the first seed, without collisions */
+	for (mask = 1; mask + 1 < count; mask = mask * 2 + 1)
+		;
+	for (; mask < MAX_WORDS * 4; mask = mask * 2 + 1)
+		for (seed = 1; seed < 100000; seed++)
+			if (try_seed(seed, mask))
+				goto found;
+	fprintf(stderr, "mkhash: no perfect hash found\n");
+	return 1;
+
+found:
+	printf("/* generated by mkhash, do not edit */\n\n");
+	printf("static const struct %s %s_table[%u] = {\n", argv[1], argv[1], mask + 1);
+	for (i = 0; i <= mask; i++)
+		if (slot[i] != -1)
+			printf("\t[%d] = {\"%s\"%s},\n", i, words[slot[i]], fields[slot[i]]);
+	printf("};\n\n");
+	printf("static const struct %s *%s_lookup(const char *word)\n{\n", argv[1], argv[1]);
+	printf("\tconst struct %s *entry;\n", argv[1]);
+	printf("\tconst char *p;\n");
+	printf("\tunsigned h = %uu;\n\n", seed);
+	printf("\tfor (p = word; *p != '\\0'; p++)\n");
+	printf("\t\th = (h ^ (unsigned char)*p) * 16777619u;\n");
+	printf("\tentry = &%s_table[(h ^ h >> 16) & %u];\n", argv[1], mask);
+	printf("\tif (entry->word == NULL || strcmp(entry->word, word) != 0)\n");
+	printf("\t\treturn NULL;\n");
+	printf("\treturn entry;\n}\n");
+	return 0;
+}
+
+/* FNV-1a from the seed, folded so the low bits see the whole word */
+static unsigned hash(const char *word, unsigned seed)
+{
+	unsigned h = seed;
+
+	for (; *word != '\0'; word++)
+		h = (h ^ (unsigned char)*word) * 16777619u;
+	return h ^ h >> 16;
+}
+
+static int try_seed(unsigned seed, unsigned mask)
+{
+	int i;
+	unsigned h;
+
+	for (i = 0; i <= mask; i++)
+		slot[i] = -1;
+	for (i = 0; i < count; i++) {
+		h = hash(words[i], seed) & mask;
+		if (slot[h] != -1)
+			return 0;
+		slot[h] = i;
+	}
+	return 1;
+}
@@ -0,0 +1,296 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "game.h"
+#include "world.h"
+#include "state.h"
+struct recording;
+static int command_id(struct recording *recording, const char *command, int *id);
+static int grow_table(struct recording *recording);
+static unsigned command_hash(const char *command);
+static void put_varint(FILE *file, uint64_t n);
+static int get_varint(const unsigned char **p, const unsigned char *end, uint64_t *n);
+
+/* A recording of a game: this header, then for each command played
+ *	varint		its id + 1, or 0 for a command not seen before, followed
+ *			by the varint length and the text; it gets the next id
+ *	byte		the response class, RESPONSE_*
+ *	8 bytes		game_hash() after it
+ *	8 bytes		world_checksum() of the text it printed, 0 for a null sink
+ * so a long session of the same few commands costs a byte or two for each
+ * command besides its hashes.
+ */
+#define RECORDING_MAGIC "forestr"
+#define RECORDING_VERSION 2
+
+struct recording_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order;	/* WORLD_BYTE_ORDER */
+	uint64_t world;		/* world_id() */
+};
+
+struct recording {
+	FILE *file;
+	char **commands;	/* id ==> text */
+	int command_count;
+	int *table;		/* open addressing, hash ==> id or -1 */
+	unsigned mask;
+};
+
+/* start recording a game, from the state it is in now */
+extern struct recording *recording_new(const struct game *game, const char *path)
+{
+	struct recording_header header;
+	struct recording *recording;
+
+	if ((recording = calloc(1, sizeof(*recording))) == NULL)
+		return NULL;
+	if (grow_table(recording) || (recording->file = fopen(path, "wb")) == NULL) {
+		free(recording->table);
+		free(recording);
+		return NULL;
+	}
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, RECORDING_MAGIC, sizeof(header.magic));
+	header.version = RECORDING_VERSION;
+	header.byte_order = WORLD_BYTE_ORDER;
+	header.world = world_id(game->world);
+	fwrite(&header, sizeof(header), 1, recording->file);
+	return recording;
+}
+
+/* add the command just played in game */
+extern int recording_add(struct recording *recording, const struct game *game, const char *command)
+{
+	uint64_t hash = game->state->hash;
+	int id;
+
+	switch (command_id(recording, command, &id)) {
+	case -1:
+		return -1;
+	case 1:
+		put_varint(recording->file, 0);
+		put_varint(recording->file, strlen(command));
+		fputs(command, recording->file);
+		break;
+	default:
+		put_varint(recording->file, id + 1);
+		break;
+	}
+	putc(game->response, recording->file);
+	fwrite(&hash, sizeof(hash), 1, recording->file);
+	fwrite(&game->response_hash, sizeof(game->response_hash), 1, recording->file);
+	return ferror(recording->file) ? -1 : 0;
+}
+
+/* finish the file; -1 if any of it could not be written */
+extern int recording_free(struct recording *recording)
+{
+	int error;
+	int i;
+
+	if (recording == NULL)
+		return 0;
+	error = ferror(recording->file);
+	if (fclose(recording->file) != 0)
+		error = 1;
+	for (i = 0; i < recording->command_count; i++)
+		free(recording->commands[i]);
+	free(recording->commands);
+	free(recording->table);
+	free(recording);
+	return error ? -1 : 0;
+}
+
+/* the id of a command; 1 if it is new, 0 if not, -1 if out of memory */
+static int command_id(struct recording *recording, const char *command, int *id)
+{
+	char **commands;
+	unsigned i;
+
+	for (i = command_hash(command) & recording->mask; recording->table[i] != -1; i = (i + 1) & recording->mask) {
+		if (strcmp(recording->commands[recording->table[i]], command) == 0) {
+			*id = recording->table[i];
+			return 0;
+		}
+	}
+	if ((commands = realloc(recording->commands, (recording->command_count + 1) * sizeof(char *))) == NULL)
+		return -1;
+	recording->commands = commands;
+	if ((commands[recording->command_count] = strdup(command)) == NULL)
+		return -1;
+	*id = recording->command_count++;
+	recording->table[i] = *id;
+
+	/* keep the table at most half full */
+	if ((unsigned)recording->command_count * 2 > recording->mask && grow_table(recording))
+		return -1;
+	return 1;
+}
+
+/* double the table, or make the first one, and put the commands back in */
+static int grow_table(struct recording *recording)
+{
+	unsigned mask = recording->mask ? recording->mask * 2 + 1 : 255;
+	unsigned i;
+	int *table;
+	int k;
+
+	if ((table = malloc((mask + 1) * sizeof(int))) == NULL)
+		return -1;
+	memset(table, -1, (mask + 1) * sizeof(int));
+	for (k = 0; k < recording->command_count; k++) {
+		for (i = command_hash(recording->commands[k]) & mask; table[i] != -1; i = (i + 1) & mask)
+			;
+		table[i] = k;
+	}
+	free(recording->table);
+	recording->table = table;
+	recording->mask = mask;
+	return 0;
+}
+
+static unsigned command_hash(const char *command)
+{
+	unsigned h = WORD_HASH_START;
+
+	for (; *command != '\0'; command++)
+		h = WORD_HASH_STEP(h, *command);
+	return h ^ h >> 16;
+}
+
+/* Play a recording into a game, into a memory sink that is emptied after
+ * each command, until it ends or a command's response or state differs
+ * from the recorded one. Returns the number of
+ * commands that matched and sets *diverged if it stopped early, or -1 and
+ * errno (EINVAL: not a recording of this world).
+ */
+extern long game_replay(struct game *game, const char *path, int *diverged)
+{
+	struct game_output out = {NULL, 0, 0};
+	const struct recording_header *header;
+	const unsigned char *p;
+	const unsigned char *end;
+	char **commands = NULL;
+	size_t count = 0;
+	size_t size = 0;
+	uint64_t n;
+	uint64_t len;
+	uint64_t hash;
+	uint64_t text_hash;
+	struct stat st;
+	void *map;
+	long played = 0;
+	int fd;
+
+	*diverged = 0;
+	if ((fd = open(path, O_RDONLY)) == -1)
+		return -1;
+	if (fstat(fd, &st) == -1) {
+		close(fd);
+		return -1;
+	}
+	if ((size_t)st.st_size < sizeof(*header)) {
+		close(fd);
+		errno = EINVAL;
+		return -1;
+	}
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return -1;
+	header = map;
+	if (memcmp(header->magic, RECORDING_MAGIC, sizeof(header->magic)) != 0 ||
+		header->version != RECORDING_VERSION ||
+		header->byte_order != WORLD_BYTE_ORDER ||
+		header->world != world_id(game->world)) {
+		errno = EINVAL;
+		played = -1;
+		goto done;
+	}
+
+	p = (const unsigned char *)(header + 1);
+	end = (const unsigned char *)map + st.st_size;
+	while (p < end) {
+		if (get_varint(&p, end, &n))
+			goto bad;
+
+		/* a new command, copied out once to end it with a NUL */
+		if (n == 0) {
+			if (get_varint(&p, end, &len) || len > (size_t)(end - p))
+				goto bad;
+			if (count == size) {
+				char **grown;
+
+				size = size ? size * 2 : 64;
+				if ((grown = realloc(commands, size * sizeof(*commands))) == NULL) {
+					played = -1;
+					goto done;
+				}
+				commands = grown;
+			}
+			if ((commands[count] = strndup((const char *)p, len)) == NULL) {
+				played = -1;
+				goto done;
+			}
+			count++;
+			p += len;
+			n = count;
+		}
+		if (n > count || end - p < 1 + (long)sizeof(hash) + (long)sizeof(text_hash))
+			goto bad;
+
+		out.len = 0;
+		game_step(game, commands[n - 1], &out);
+		memcpy(&hash, p + 1, sizeof(hash));
+		memcpy(&text_hash, p + 1 + sizeof(hash), sizeof(text_hash));
+		if (game->response != *p || game->state->hash != hash ||
+			(text_hash != 0 && game->response_hash != text_hash)) {
+			*diverged = 1;
+			break;
+		}
+		p += 1 + sizeof(hash) + sizeof(text_hash);
+		played++;
+	}
+	goto done;
+
+bad:
+	errno = EINVAL;
+	played = -1;
+done:
+	while (count > 0)
+		free(commands[--count]);
+	free(commands);
+	free(out.text);
+	munmap(map, st.st_size);
+	return played;
+}
+
+/* LEB128 */
+static void put_varint(FILE *file, uint64_t n)
+{
+	while (n >= 0x80) {
+		putc((n & 0x7f) | 0x80, file);
+		n >>= 7;
+	}
+	putc(n, file);
+}
+
+static int get_varint(const unsigned char **p, const unsigned char *end, uint64_t *n)
+{
+	int shift;
+
+	*n = 0;
+	for (shift = 0; *p < end && shift < 64; shift += 7) {
+		*n |= (uint64_t)(**p & 0x7f) << shift;
+		if ((*(*p)++ & 0x80) == 0)
+			return 0;
+	}
+	return 1;
+}
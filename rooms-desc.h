@@ -1,13 +1,6 @@
-struct room {
-	const int room_id;
-	const char *room_name;
-	const char *room_desc;
-	int walk_to[4];
-	const char *walk_desc[4];
-	const char *search_desc;
-};
+/* rooms of the built-in world, see struct room_desc in world.h */
 
-static struct room locations[] = {
+static const struct room_desc locations[] = {
 	{
 		0,
 		"Village Entrance",
@@ -2,82 +2,86 @@
 #include <stdlib.h>
 #include <string.h>
 #include "rooms.h"
-#include "rooms-desc.h"
+#include "state.h"
 #include "items.h"
-static void room_exits(void);
+static void room_exits(struct game *game);
 
-/* room variable - start in room 0 */
-static int current_room = 0;
+/* a direction word, see directions.txt */
+struct direction {
+	const char *word;
+	int dir;
+};
+
+#include "directions.h"
+
+static const char *dirs[4] = {"north", "east", "south", "west"};
 
 /* current room_id */
-extern int room_id(void)
+extern int room_id(struct game *game)
 {
-	return current_room;
+	return game->state->room;
 }
 
 /* provide room description */
-extern void look_room(void)
+extern void look_room(struct game *game)
 {
-	printf("\n%s\n",locations[current_room].room_name);
-	printf("\n%s\n",locations[current_room].room_desc);
-	room_items(current_room);
-	room_exits();
+	const struct room *room = &game->world->rooms[game->state->room];
+
+	game_printf(game, "\n%s\n",world_string(game->world, room->room_name));
+	game_printf(game, "\n%s\n",world_string(game->world, room->room_desc));
+	room_items(game, game->state->room);
+	room_exits(game);
 }
 
-static void room_exits(void)
+static void room_exits(struct game *game)
 {
 	int i;
 	int count;
-	char *dirs[4] = {"north","east","south","west"};
-	printf("Exits:  ");
+	game_printf(game, "Exits:  ");
 	for (count = 0, i = 0; i < 4; i++) {
-		if (locations[current_room].walk_to[i] != -1) {
-			printf("%s  ",dirs[i]);
+		if (room_exit(game, game->state->room, i) != -1) {
+			game_printf(game, "%s  ",dirs[i]);
 			count++;
 		}
 	}
-	if (count == 0) printf("none");
-	putchar('\n');
+	if (count == 0) game_printf(game, "none");
+	game_putchar(game, '\n');
 }
 
-extern void move(char *direction)
+extern void move(struct game *game, const char *direction)
 {
-	int dir;
-
-	putchar('\n');
+	const struct direction *entry;
 
 	/* figure out direction */
-	if (direction == NULL) {
-		printf("Walk where?\n");
-		return;
-	} else if (strcmp(direction,"north") == 0) {
-		dir = 0;
-	} else if (strcmp(direction,"east") == 0) {
-		dir = 1;
-	} else if (strcmp(direction,"south") == 0) {
-		dir = 2;
-	} else if (strcmp(direction,"west") == 0) {
-		dir = 3;
-	} else {
-		printf("Walk where?\n");
+	if (direction == NULL || (entry = direction_lookup(direction)) == NULL) {
+		game_printf(game, "\nWalk where?\n");
 		return;
 	}
+	move_dir(game, entry->dir);
+}
+
+/* move in a direction already looked up, as the verbs "north" ... are */
+extern void move_dir(struct game *game, int dir)
+{
+	const struct room *room = &game->world->rooms[game->state->room];
+	int to;
 
-	/* move */
-	if (locations[current_room].walk_to[dir] != -1) {
-		printf("%s\n",locations[current_room].walk_desc[dir]);
-		current_room = locations[current_room].walk_to[dir];
-		look_room();
+	game_putchar(game, '\n');
+	if ((to = room_exit(game, game->state->room, dir)) != -1) {
+		game_printf(game, "%s\n",world_string(game->world, room->walk_desc[dir]));
+		set_room(game, to);
+		look_room(game);
 	} else {
-		printf("You cannot walk %s.\n",direction);
+		game_printf(game, "You cannot walk %s.\n",dirs[dir]);
 	}
-
 }
 
-extern int search_desc(void)
+extern int search_desc(struct game *game)
 {
-	if (locations[current_room].search_desc != NULL) {
-		printf("%s ", locations[current_room].search_desc);
+	const struct room *room = &game->world->rooms[game->state->room];
+
+	if (room->search_desc != 0) {
+		game_printf(game, "%s ", world_string(game->world, room->search_desc));
 		return 0;
 	} else {
 		return 1;
@@ -85,7 +89,7 @@ extern int search_desc(void)
 
 }
 
-extern void location_move(int room, int dir, int loc)
+extern void location_move(struct game *game, int room, int dir, int loc)
 {
-	locations[room].walk_to[dir] = loc;
+	set_room_exit(game, room, dir, loc);
 }
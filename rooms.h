@@ -1,10 +1,13 @@
 #ifndef ROOMS_H
 #define ROOMS_H
 
-extern int room_id(void);
-extern void look_room(void);
-extern void move(char *direction);
-extern int search_desc(void);
-extern void location_move(int room, int dir, int loc);
+#include "game.h"
+
+extern int room_id(struct game *game);
+extern void look_room(struct game *game);
+extern void move(struct game *game, const char *direction);
+extern void move_dir(struct game *game, int dir);
+extern int search_desc(struct game *game);
+extern void location_move(struct game *game, int room, int dir, int loc);
 
 #endif
@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include "game.h"
+#include "world.h"
+#include "state.h"
+struct save_header;
+static void save_header(const struct game *game, struct save_header *header);
+
+/* A saved game: this header, then the game's state block as it is, so
+ * saving is one writev and loading one mapping and one copy however long
+ * the game has been played.
+ */
+#define SAVE_MAGIC "forests"
+#define SAVE_VERSION 1
+
+struct save_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order;	/* WORLD_BYTE_ORDER */
+	uint64_t world;		/* world_id() */
+	uint64_t state_size;
+	uint64_t checksum;	/* of the state block */
+};
+
+/* the header a save of this game has */
+static void save_header(const struct game *game, struct save_header *header)
+{
+	memset(header, 0, sizeof(*header));
+	memcpy(header->magic, SAVE_MAGIC, sizeof(header->magic));
+	header->version = SAVE_VERSION;
+	header->byte_order = WORLD_BYTE_ORDER;
+	header->world = world_id(game->world);
+	header->state_size = game->world->state_size;
+	header->checksum = world_checksum(game->state, game->world->state_size);
+}
+
+/* write the game to path, through a temporary file so a failed save
+ * leaves the old one alone */
+extern int game_save(const struct game *game, const char *path)
+{
+	struct save_header header;
+	struct iovec iov[2];
+	char *temp;
+	ssize_t n;
+	int fd;
+	int error = 0;
+
+	if ((temp = malloc(strlen(path) + 5)) == NULL)
+		return -1;
+	sprintf(temp, "%s.tmp", path);
+	if ((fd = open(temp, O_WRONLY | O_CREAT | O_TRUNC, 0644)) == -1) {
+		free(temp);
+		return -1;
+	}
+	save_header(game, &header);
+	iov[0].iov_base = &header;
+	iov[0].iov_len = sizeof(header);
+	iov[1].iov_base = game->state;
+	iov[1].iov_len = game->world->state_size;
+	if ((n = writev(fd, iov, 2)) == -1)
+		error = errno;
+	else if ((size_t)n != sizeof(header) + game->world->state_size)
+		error = EIO;
+	if (close(fd) == -1 && error == 0)
+		error = errno;
+	if (error == 0 && rename(temp, path) == -1)
+		error = errno;
+	if (error != 0)
+		unlink(temp);
+	free(temp);
+	errno = error;
+	return error == 0 ? 0 : -1;
+}
+
+/* replace the game with one saved from the same world; EINVAL if the file
+ * is not such a save */
+extern int game_load(struct game *game, const char *path)
+{
+	const struct world *world = game->world;
+	struct save_header header;
+	const struct save_header *saved;
+	const struct state *state;
+	struct stat st;
+	void *map;
+	int fd;
+	int ok;
+
+	if ((fd = open(path, O_RDONLY)) == -1)
+		return -1;
+	if (fstat(fd, &st) == -1) {
+		close(fd);
+		return -1;
+	}
+	if ((size_t)st.st_size != sizeof(header) + world->state_size) {
+		close(fd);
+		errno = EINVAL;
+		return -1;
+	}
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return -1;
+
+	/* same format, same world, intact, and a state this world can be in */
+	saved = map;
+	state = (const struct state *)(saved + 1);
+	save_header(game, &header);
+	ok = memcmp(saved->magic, header.magic, sizeof(header.magic)) == 0 &&
+		saved->version == header.version &&
+		saved->byte_order == header.byte_order &&
+		saved->world == header.world &&
+		saved->state_size == header.state_size &&
+		saved->checksum == world_checksum(state, world->state_size) &&
+		state_check(world, state);
+	if (ok)
+		game_restore(game, state);
+	munmap(map, st.st_size);
+	if (!ok) {
+		errno = EINVAL;
+		return -1;
+	}
+	return 0;
+}
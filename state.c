@@ -0,0 +1,338 @@
+#include <stdlib.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "state.h"
+#include "journal.h"
+#include "trace.h"
+static int bit_assign(uint64_t *bits, int i, int yes);
+static uint64_t mix(uint64_t x);
+static uint64_t zobrist(int field, int index, int value);
+static uint64_t state_hash(const struct world *world, const struct state *state);
+static int32_t *room_list(const struct world *world, struct state *state, int loc);
+static void list_insert(int32_t *first, int32_t *next, int prev, int item);
+static void list_remove(int32_t *first, int32_t *next, int prev, int item);
+static int find_last(const int32_t *table, int end, int32_t value);
+static int last_bit(const uint64_t *bits, int end);
+static long list_check(const struct world *world, const struct state *state,
+	int first, const int32_t *next, int loc);
+
+/* a state block holding the world's starting values */
+extern struct state *state_new(const struct world *world)
+{
+	struct state *state;
+	uint64_t *bits;
+	int32_t *table;
+	int i;
+
+	if ((state = calloc(1, world->state_size)) == NULL)
+		return NULL;
+	state->room = 0;
+	state->status = 0;
+
+	bits = state->bits;
+	table = (int32_t *)((char *)state + world->locations);
+	for (i = 0; i < world->item_count; i++) {
+		bit_assign(bits + world->hidden, i, world->items[i].hidden == YES);
+		table[i] = world->items[i].location;
+	}
+	for (i = 0; i < world->event_count; i++)
+		bit_assign(bits + world->triggerable, i, world->events[i].triggerable == YES);
+
+	table = (int32_t *)((char *)state + world->exits);
+	for (i = 0; i < world->room_count * 4; i++)
+		if (world->exit_slot[i] != -1)
+			table[world->exit_slot[i]] = world->rooms[i / 4].walk_to[i % 4];
+
+	/* pushing the items last to first leaves every list in order */
+	table = (int32_t *)((char *)state + world->room_first);
+	for (i = 0; i < world->room_count; i++)
+		table[i] = -1;
+	*(int32_t *)((char *)state + world->inventory_first) = -1;
+	for (i = 0; i < world->item_count; i++) {
+		((int32_t *)((char *)state + world->room_next))[i] = -1;
+		((int32_t *)((char *)state + world->inventory_next))[i] = -1;
+	}
+	for (i = world->item_count - 1; i >= 0; i--)
+		if (world->items[i].location >= 0 && world->items[i].location < world->room_count)
+			list_insert(table + world->items[i].location,
+				(int32_t *)((char *)state + world->room_next), -1, i);
+	state->hash = state_hash(world, state);
+	return state;
+}
+
+/* Whether a state block from outside, a saved game say, is one the setters
+ * could have left: every value in range, every list in item order (so it
+ * ends) and holding just the items it should, and the hash right.
+ */
+extern int state_check(const struct world *world, const struct state *state)
+{
+	const int32_t *locations = (const int32_t *)((const char *)state + world->locations);
+	const int32_t *exits = (const int32_t *)((const char *)state + world->exits);
+	const int32_t *room_first = (const int32_t *)((const char *)state + world->room_first);
+	const int32_t *room_next = (const int32_t *)((const char *)state + world->room_next);
+	const int32_t *inventory_first = (const int32_t *)((const char *)state + world->inventory_first);
+	const int32_t *inventory_next = (const int32_t *)((const char *)state + world->inventory_next);
+	long in_rooms = 0;
+	long carried = 0;
+	long listed = 0;
+	long n;
+	int i;
+
+	if (state->room < 0 || state->room >= world->room_count || state->status > 0 || state->status < -3)
+		return 0;
+	for (i = 0; i < world->item_count; i++) {
+		if (locations[i] < -1 || locations[i] >= world->room_count)
+			return 0;
+		in_rooms += locations[i] >= 0;
+		carried += bit_test(state->bits + world->inventory, i);
+	}
+	for (i = 0; i < world->exit_count; i++)
+		if (exits[i] < -1 || exits[i] >= world->room_count)
+			return 0;
+
+	for (i = 0; i < world->room_count; i++) {
+		if ((n = list_check(world, state, room_first[i], room_next, i)) == -1)
+			return 0;
+		listed += n;
+	}
+	if (listed != in_rooms || list_check(world, state, *inventory_first, inventory_next, -1) != carried)
+		return 0;
+	return state->hash == state_hash(world, state);
+}
+
+/* the length of a list whose items must all be at loc (-1: carried), or -1 */
+static long list_check(const struct world *world, const struct state *state,
+	int first, const int32_t *next, int loc)
+{
+	const int32_t *locations = (const int32_t *)((const char *)state + world->locations);
+	long n = 0;
+	int prev = -1;
+	int i;
+
+	for (i = first; i != -1; prev = i, i = next[i], n++)
+		if (i <= prev || i >= world->item_count ||
+			(loc == -1 ? !bit_test(state->bits + world->inventory, i) : locations[i] != loc))
+			return -1;
+	return n;
+}
+
+/* the list head for a location, or NULL if it is not a room */
+static int32_t *room_list(const struct world *world, struct state *state, int loc)
+{
+	if (loc < 0 || loc >= world->room_count)
+		return NULL;
+	return (int32_t *)((char *)state + world->room_first) + loc;
+}
+
+/* The lists are kept in item order, so an item goes after prev, the last
+ * item before it in the same list (-1 for none). The callers find prev by
+ * scanning the dense location table or the inventory bitset, which stays
+ * fast however long the list is; walking the list would not.
+ */
+static void list_insert(int32_t *first, int32_t *next, int prev, int item)
+{
+	int32_t *link = prev == -1 ? first : &next[prev];
+
+	next[item] = *link;
+	*link = item;
+}
+
+static void list_remove(int32_t *first, int32_t *next, int prev, int item)
+{
+	int32_t *link = prev == -1 ? first : &next[prev];
+
+	*link = next[item];
+	next[item] = -1;
+}
+
+/* the last j < end with table[j] == value, or -1 */
+static int find_last(const int32_t *table, int end, int32_t value)
+{
+	int j = end;
+
+#if defined(__SSE2__)
+	__m128i v = _mm_set1_epi32(value);
+
+	/* 16 items a round, as four compares of 4 */
+	for (; j >= 16; j -= 16) {
+		__m128i a = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(table + j - 16)), v);
+		__m128i b = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(table + j - 12)), v);
+		__m128i c = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(table + j - 8)), v);
+		__m128i d = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(table + j - 4)), v);
+		unsigned mask = _mm_movemask_ps(_mm_castsi128_ps(a)) |
+			_mm_movemask_ps(_mm_castsi128_ps(b)) << 4 |
+			_mm_movemask_ps(_mm_castsi128_ps(c)) << 8 |
+			_mm_movemask_ps(_mm_castsi128_ps(d)) << 12;
+		if (mask != 0)
+			return j - 16 + 31 - __builtin_clz(mask);
+	}
+#endif
+	while (--j >= 0)
+		if (table[j] == value)
+			return j;
+	return -1;
+}
+
+/* the last set bit before end, or -1: 64 items a word */
+static int last_bit(const uint64_t *bits, int end)
+{
+	int w = end / 64;
+	uint64_t word = end % 64 == 0 ? 0 : bits[w] & (((uint64_t)1 << (end % 64)) - 1);
+
+	while (word == 0) {
+		if (--w < 0)
+			return -1;
+		word = bits[w];
+	}
+	return w * 64 + 63 - __builtin_clzll(word);
+}
+
+/* splitmix64 finalizer */
+static uint64_t mix(uint64_t x)
+{
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+	return x ^ (x >> 31);
+}
+
+/* The key for a field holding a value. Keys are computed rather than
+ * looked up, so a world with many rooms does not need a table of
+ * items * rooms of them.
+ */
+static uint64_t zobrist(int field, int index, int value)
+{
+	return mix(mix(((uint64_t)field << 32 | (uint32_t)index) + 0x9e3779b97f4a7c15) ^ (uint32_t)value);
+}
+
+/* hash of a whole block, from scratch */
+static uint64_t state_hash(const struct world *world, const struct state *state)
+{
+	const uint64_t *bits = state->bits;
+	const int32_t *table;
+	uint64_t hash;
+	int i;
+
+	hash = zobrist(F_ROOM, 0, state->room) ^ zobrist(F_STATUS, 0, state->status);
+	table = (const int32_t *)((const char *)state + world->locations);
+	for (i = 0; i < world->item_count; i++) {
+		if (bit_test(bits + world->hidden, i))
+			hash ^= zobrist(F_HIDDEN, i, YES);
+		if (bit_test(bits + world->inventory, i))
+			hash ^= zobrist(F_INVENTORY, i, YES);
+		hash ^= zobrist(F_LOCATION, i, table[i]);
+	}
+	for (i = 0; i < world->event_count; i++)
+		if (bit_test(bits + world->triggerable, i))
+			hash ^= zobrist(F_TRIGGERABLE, i, YES);
+	table = (const int32_t *)((const char *)state + world->exits);
+	for (i = 0; i < world->exit_count; i++)
+		hash ^= zobrist(F_EXIT, i, table[i]);
+	return hash;
+}
+
+/* set or clear a bit, and return whether it changed */
+static int bit_assign(uint64_t *bits, int i, int yes)
+{
+	if (bit_test(bits, i) == !!yes)
+		return 0;
+	if (yes)
+		bits[i / 64] |= (uint64_t)1 << (i % 64);
+	else
+		bits[i / 64] &= ~((uint64_t)1 << (i % 64));
+	return 1;
+}
+
+extern void set_room(struct game *game, int room)
+{
+	struct state *state = game->state;
+
+	if (state->room == room)
+		return;
+	journal_record(game, F_ROOM, 0, state->room, room);
+	TRACE(game, TRACE_ROOM, state->room, room, 0);
+	state->hash ^= zobrist(F_ROOM, 0, state->room) ^ zobrist(F_ROOM, 0, room);
+	state->room = room;
+}
+
+extern void set_status(struct game *game, int status)
+{
+	struct state *state = game->state;
+
+	if (state->status == status)
+		return;
+	journal_record(game, F_STATUS, 0, state->status, status);
+	TRACE(game, TRACE_STATE, F_STATUS, 0, status);
+	state->hash ^= zobrist(F_STATUS, 0, state->status) ^ zobrist(F_STATUS, 0, status);
+	state->status = status;
+}
+
+/* only exits with a slot can change, see world_index() */
+extern void set_room_exit(struct game *game, int room, int dir, int loc)
+{
+	int slot = game->world->exit_slot[room * 4 + dir];
+	int32_t *exits;
+
+	if (slot == -1)
+		return;
+	exits = state_table(game, game->world->exits);
+	if (exits[slot] == loc)
+		return;
+	journal_record(game, F_EXIT, room * 4 + dir, exits[slot], loc);
+	TRACE(game, TRACE_STATE, F_EXIT, room * 4 + dir, loc);
+	game->state->hash ^= zobrist(F_EXIT, slot, exits[slot]) ^ zobrist(F_EXIT, slot, loc);
+	exits[slot] = loc;
+}
+
+extern void set_item_location(struct game *game, int item, int loc)
+{
+	int32_t *locations = state_table(game, game->world->locations);
+	int32_t *next = state_table(game, game->world->room_next);
+	int32_t *list;
+
+	if (locations[item] == loc)
+		return;
+	journal_record(game, F_LOCATION, item, locations[item], loc);
+	TRACE(game, TRACE_STATE, F_LOCATION, item, loc);
+	if ((list = room_list(game->world, game->state, locations[item])) != NULL)
+		list_remove(list, next, find_last(locations, item, locations[item]), item);
+	if ((list = room_list(game->world, game->state, loc)) != NULL)
+		list_insert(list, next, find_last(locations, item, loc), item);
+	game->state->hash ^= zobrist(F_LOCATION, item, locations[item]) ^ zobrist(F_LOCATION, item, loc);
+	locations[item] = loc;
+}
+
+extern void set_item_hidden(struct game *game, int item, int hidden)
+{
+	if (!bit_assign(game->state->bits + game->world->hidden, item, hidden))
+		return;
+	journal_record(game, F_HIDDEN, item, !hidden, !!hidden);
+	TRACE(game, TRACE_STATE, F_HIDDEN, item, !!hidden);
+	game->state->hash ^= zobrist(F_HIDDEN, item, YES);
+}
+
+extern void set_in_inventory(struct game *game, int item, int yes)
+{
+	uint64_t *bits = game->state->bits + game->world->inventory;
+	int32_t *first = state_table(game, game->world->inventory_first);
+	int32_t *next = state_table(game, game->world->inventory_next);
+
+	if (!bit_assign(bits, item, yes))
+		return;
+	journal_record(game, F_INVENTORY, item, !yes, !!yes);
+	TRACE(game, TRACE_STATE, F_INVENTORY, item, !!yes);
+	if (yes)
+		list_insert(first, next, last_bit(bits, item), item);
+	else
+		list_remove(first, next, last_bit(bits, item), item);
+	game->state->hash ^= zobrist(F_INVENTORY, item, YES);
+}
+
+extern void set_event_triggerable(struct game *game, int event, int yes)
+{
+	if (!bit_assign(game->state->bits + game->world->triggerable, event, yes))
+		return;
+	journal_record(game, F_TRIGGERABLE, event, !yes, !!yes);
+	TRACE(game, TRACE_STATE, F_TRIGGERABLE, event, !!yes);
+	game->state->hash ^= zobrist(F_TRIGGERABLE, event, YES);
+}
@@ -0,0 +1,103 @@
+#ifndef STATE_H
+#define STATE_H
+
+#include <stdint.h>
+#include "game.h"
+#include "world.h"
+
+/* Everything that changes during play, packed into one block so a game can
+ * be copied with a single memcpy: this header, then bitsets of hidden items,
+ * items in the inventory and triggerable events, then the int32_t location of
+ * every item, the current target of every exit slot, and the lists of items
+ * in each room and in the inventory. The offsets are in struct world.
+ *
+ * hash is the XOR of a key for every (field, value) pair in the block. The
+ * setters below keep it up to date, so it must not be written directly.
+ */
+struct state {
+	int32_t room;
+	int32_t status;		/* 0 playing, -1 quit, -2 bad ending, -3 good ending */
+	uint64_t hash;
+	uint64_t bits[];
+};
+
+#define BITSET_WORDS(n) (((n) + 63) / 64)
+
+/* fields of the state, for its hash and the journal */
+enum { F_ROOM, F_STATUS, F_HIDDEN, F_INVENTORY, F_TRIGGERABLE, F_LOCATION, F_EXIT };
+
+extern struct state *state_new(const struct world *world);
+extern int state_check(const struct world *world, const struct state *state);
+extern void set_room(struct game *game, int room);
+extern void set_status(struct game *game, int status);
+extern void set_room_exit(struct game *game, int room, int dir, int loc);
+extern void set_item_location(struct game *game, int item, int loc);
+extern void set_item_hidden(struct game *game, int item, int hidden);
+extern void set_in_inventory(struct game *game, int item, int yes);
+extern void set_event_triggerable(struct game *game, int event, int yes);
+
+static inline int bit_test(const uint64_t *bits, int i)
+{
+	return (bits[i / 64] >> (i % 64)) & 1;
+}
+
+static inline int32_t *state_table(const struct game *game, size_t offset)
+{
+	return (int32_t *)((char *)game->state + offset);
+}
+
+static inline int item_location(const struct game *game, int item)
+{
+	return state_table(game, game->world->locations)[item];
+}
+
+static inline int item_hidden(const struct game *game, int item)
+{
+	return bit_test(game->state->bits + game->world->hidden, item);
+}
+
+static inline int in_inventory(const struct game *game, int item)
+{
+	return bit_test(game->state->bits + game->world->inventory, item);
+}
+
+static inline int event_triggerable(const struct game *game, int event)
+{
+	return bit_test(game->state->bits + game->world->triggerable, event);
+}
+
+/* Items in a room or in the inventory, in table order, so non-takeable items
+ * come first:
+ *	for (i = room_first(game, room); i != -1; i = room_next(game, i))
+ */
+static inline int room_first(const struct game *game, int room)
+{
+	return state_table(game, game->world->room_first)[room];
+}
+
+static inline int room_next(const struct game *game, int item)
+{
+	return state_table(game, game->world->room_next)[item];
+}
+
+static inline int inventory_first(const struct game *game)
+{
+	return *state_table(game, game->world->inventory_first);
+}
+
+static inline int inventory_next(const struct game *game, int item)
+{
+	return state_table(game, game->world->inventory_next)[item];
+}
+
+/* where an exit leads now, -1 if nowhere */
+static inline int room_exit(const struct game *game, int room, int dir)
+{
+	int slot = game->world->exit_slot[room * 4 + dir];
+
+	if (slot == -1)
+		return game->world->rooms[room].walk_to[dir];
+	return state_table(game, game->world->exits)[slot];
+}
+
+#endif
@@ -0,0 +1,123 @@
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include "trace.h"
+static void copy_record(struct trace_record *copy, const struct trace_record *record, uint64_t seq);
+static int write_all(int fd, const void *data, size_t size);
+static uint64_t now(void);
+
+/* records copied out of the ring at a time by game_trace_dump() */
+#define DUMP_RECORDS 64
+
+/* Trace a game in a ring of at least records records, from empty, or stop
+ * tracing it for 0. Returns 0, or -1 and errno (ENOSYS: built without it).
+ */
+extern int game_trace(struct game *game, size_t records)
+{
+#ifdef NO_TRACE
+	errno = ENOSYS;
+	return records ? -1 : 0;
+#else
+	struct trace *trace;
+	size_t size;
+
+	free(game->trace);
+	game->trace = NULL;
+	if (records == 0)
+		return 0;
+	for (size = 64; size < records; size *= 2)
+		;
+	if ((trace = calloc(1, sizeof(*trace) + size * sizeof(struct trace_record))) == NULL)
+		return -1;
+	trace->mask = size - 1;
+	trace->ns_start = now();
+	trace->tsc_start = trace_clock();
+	game->trace = trace;
+	return 0;
+#endif
+}
+
+/* Write what the ring holds to fd, oldest record first. Only makes
+ * calls that are safe in a signal handler, so a crash can leave a trace.
+ * The records are copied out a few at a time, each checked against its seq,
+ * so the game can go on tracing from another thread meanwhile.
+ */
+extern int game_trace_dump(const struct game *game, int fd)
+{
+	const struct trace *trace = game->trace;
+	struct trace_header header;
+	struct trace_record records[DUMP_RECORDS];
+	uint64_t head;
+	uint64_t seq;
+	size_t i;
+	size_t n;
+
+	if (trace == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+	head = __atomic_load_n(&trace->head, __ATOMIC_ACQUIRE);
+	seq = head > trace->mask + 1 ? head - (trace->mask + 1) : 0;
+
+	/* no memset or memcpy, to stay signal safe */
+	for (i = 0; i < sizeof(header.magic); i++)
+		header.magic[i] = TRACE_MAGIC[i];
+	header.version = TRACE_VERSION;
+	header.record_size = sizeof(struct trace_record);
+	header.count = head - seq;
+	header.lost = seq;
+	header.tsc_start = trace->tsc_start;
+	header.ns_start = trace->ns_start;
+	header.ns_dump = now();
+	header.tsc_dump = trace_clock();
+	if (write_all(fd, &header, sizeof(header)) == -1)
+		return -1;
+
+	while (seq < head) {
+		for (n = 0; n < DUMP_RECORDS && seq < head; n++, seq++)
+			copy_record(&records[n], &trace->records[seq & trace->mask], seq + 1);
+		if (write_all(fd, records, n * sizeof(records[0])) == -1)
+			return -1;
+	}
+	return 0;
+}
+
+/* a record as the game published it with seq, or with seq 0 if the game has
+ * reused its slot, before or during the copy */
+static void copy_record(struct trace_record *copy, const struct trace_record *record, uint64_t seq)
+{
+	uint64_t before = __atomic_load_n(&record->seq, __ATOMIC_ACQUIRE);
+	int i;
+
+	copy->tsc = record->tsc;
+	copy->type = record->type;
+	for (i = 0; i < 3; i++)
+		copy->arg[i] = record->arg[i];
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	copy->seq = before == seq && __atomic_load_n(&record->seq, __ATOMIC_RELAXED) == seq ? seq : 0;
+}
+
+static int write_all(int fd, const void *data, size_t size)
+{
+	ssize_t n;
+
+	while (size > 0) {
+		if ((n = write(fd, data, size)) == -1) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		data = (const char *)data + n;
+		size -= n;
+	}
+	return 0;
+}
+
+static uint64_t now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
@@ -0,0 +1,132 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <string.h>
+#include "game.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+
+/* A game's trace: the last records of what it did, in a ring that the game
+ * writes without locks or system calls, and that game_trace_dump() writes
+ * out for tracedump to read. Building with -DNO_TRACE takes the TRACE()
+ * calls out; otherwise a game that is not traced pays one test of
+ * game->trace for each.
+ */
+enum {
+	TRACE_COMMAND,		/* text: the command line, cut short */
+	TRACE_VERB,		/* text: the verb it was played as, "" if unknown */
+	TRACE_ITEM,		/* item found or -1 none or -2 ambiguous, room or -1 inventory, name word */
+	TRACE_EVENT,		/* event fired, its type, room */
+	TRACE_STATE,		/* F_* field changed, index, new value */
+	TRACE_ROOM,		/* old room, new room */
+	TRACE_TYPES
+};
+
+struct trace_record {
+	uint64_t seq;		/* records written before it and it, 0 while it is written */
+	uint64_t tsc;		/* trace_clock() */
+	uint32_t type;		/* TRACE_* */
+	union {
+		int32_t arg[3];
+		char text[12];	/* NUL-terminated only if shorter */
+	};
+};
+
+/* A dump: this header, then count records, oldest first. The two pairs of
+ * clock readings, when tracing started and at the dump, turn ticks into
+ * time. A record the game wrote over while it was being copied has seq 0.
+ */
+#define TRACE_MAGIC "forestt"
+#define TRACE_VERSION 2
+
+struct trace_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t record_size;
+	uint64_t count;
+	uint64_t lost;		/* records written over before the dump */
+	uint64_t tsc_start;
+	uint64_t ns_start;
+	uint64_t tsc_dump;
+	uint64_t ns_dump;
+};
+
+struct trace {
+	uint64_t head;		/* records written */
+	uint64_t mask;		/* of the ring's size, a power of two */
+	uint64_t tsc_start;
+	uint64_t ns_start;
+	struct trace_record records[];
+};
+
+/* the time stamp counter where there is one, nanoseconds elsewhere */
+static inline uint64_t trace_clock(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+/* Fill the next slot between two stamps of its seq, as a seqlock: a dump,
+ * from a signal handler or another thread, that copies a slot while it is
+ * reused sees seq change across the copy and drops the record.
+ */
+static inline struct trace_record *trace_next(struct trace *trace, uint32_t type)
+{
+	struct trace_record *record = &trace->records[trace->head & trace->mask];
+
+	__atomic_store_n(&record->seq, 0, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	record->tsc = trace_clock();
+	record->type = type;
+	return record;
+}
+
+static inline void trace_publish(struct trace *trace)
+{
+	uint64_t head = trace->head + 1;
+
+	__atomic_store_n(&trace->records[trace->head & trace->mask].seq, head, __ATOMIC_RELEASE);
+	__atomic_store_n(&trace->head, head, __ATOMIC_RELEASE);
+}
+
+static inline void trace_write(struct trace *trace, uint32_t type, int32_t a, int32_t b, int32_t c)
+{
+	struct trace_record *record = trace_next(trace, type);
+
+	record->arg[0] = a;
+	record->arg[1] = b;
+	record->arg[2] = c;
+	trace_publish(trace);
+}
+
+static inline void trace_text(struct trace *trace, uint32_t type, const char *text)
+{
+	strncpy(trace_next(trace, type)->text, text, sizeof(((struct trace_record *)0)->text));
+	trace_publish(trace);
+}
+
+#ifdef NO_TRACE
+#define TRACE(game, type, a, b, c) ((void)0)
+#define TRACE_TEXT(game, type, text) ((void)0)
+#else
+#define TRACE(game, type, a, b, c) do { \
+	if ((game)->trace != NULL) \
+		trace_write((game)->trace, type, a, b, c); \
+} while (0)
+#define TRACE_TEXT(game, type, text) do { \
+	if ((game)->trace != NULL) \
+		trace_text((game)->trace, type, text); \
+} while (0)
+#endif
+
+#endif
@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "trace.h"
+#include "state.h"
+int main(int argc, char *argv[]);
+static int dump(FILE *in, const char *name);
+static void print_record(const struct trace_record *record);
+
+/* tracedump - print a trace written by game_trace_dump() as a timeline
+ *
+ *	tracedump [file]	read file, or standard input
+ *
+ * Each line is the time since the first record and since the one before,
+ * in microseconds, then what happened; a blank line starts each command.
+ */
+
+static const char *fields[] = {
+	[F_ROOM] = "room", [F_STATUS] = "status", [F_HIDDEN] = "hidden",
+	[F_INVENTORY] = "inventory", [F_TRIGGERABLE] = "triggerable",
+	[F_LOCATION] = "location", [F_EXIT] = "exit",
+};
+static const char *event_types[] = {
+	[OPEN] = "open", [BREAK] = "break", [CREATE] = "create", [STORY] = "story", [TAKE] = "take",
+};
+static const char *dirs[4] = {"north", "east", "south", "west"};
+
+int main(int argc, char *argv[])
+{
+	FILE *in = stdin;
+	int status;
+
+	if (argc > 2) {
+		fprintf(stderr, "usage: tracedump [file]\n");
+		return 1;
+	}
+	if (argc == 2 && (in = fopen(argv[1], "rb")) == NULL) {
+		perror(argv[1]);
+		return 1;
+	}
+	status = dump(in, argc == 2 ? argv[1] : "stdin");
+	if (in != stdin)
+		fclose(in);
+	return status;
+}
+
+static int dump(FILE *in, const char *name)
+{
+	struct trace_header header;
+	struct trace_record record;
+	double ticks_per_us = 1;
+	uint64_t first = 0;
+	uint64_t last = 0;
+	uint64_t torn = 0;
+	uint64_t i;
+
+	if (fread(&header, sizeof(header), 1, in) != 1 ||
+		memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0 ||
+		header.version != TRACE_VERSION ||
+		header.record_size != sizeof(record)) {
+		fprintf(stderr, "tracedump: %s: not a forest trace\n", name);
+		return 1;
+	}
+	if (header.ns_dump > header.ns_start && header.tsc_dump > header.tsc_start)
+		ticks_per_us = (double)(header.tsc_dump - header.tsc_start) * 1000 /
+			(header.ns_dump - header.ns_start);
+	printf("# %llu records, %llu lost before them, %.1f ticks per us\n",
+		(unsigned long long)header.count, (unsigned long long)header.lost, ticks_per_us);
+
+	for (i = 0; i < header.count; i++) {
+		if (fread(&record, sizeof(record), 1, in) != 1) {
+			fprintf(stderr, "tracedump: %s: cut short after %llu records\n",
+				name, (unsigned long long)i);
+			return 1;
+		}
+		if (record.seq != header.lost + i + 1) {
+			torn++;		/* written over while it was dumped */
+			continue;
+		}
+		if (i == torn)
+			first = last = record.tsc;
+		if (record.type == TRACE_COMMAND)
+			putchar('\n');
+		printf("%12.3f %+10.3f  ", (record.tsc - first) / ticks_per_us,
+			(double)(int64_t)(record.tsc - last) / ticks_per_us);
+		print_record(&record);
+		last = record.tsc;
+	}
+	if (torn > 0)
+		printf("# %llu records written over during the dump left out\n", (unsigned long long)torn);
+	return 0;
+}
+
+static void print_record(const struct trace_record *record)
+{
+	const int32_t *arg = record->arg;
+
+	switch (record->type) {
+	case TRACE_COMMAND:
+		printf("command  \"%.*s\"\n", (int)sizeof(record->text), record->text);
+		break;
+	case TRACE_VERB:
+		if (record->text[0] == '\0')
+			printf("verb     unknown\n");
+		else
+			printf("verb     %.*s\n", (int)sizeof(record->text), record->text);
+		break;
+	case TRACE_ITEM:
+		printf("item     word %d: ", arg[2]);
+		if (arg[0] == -1)
+			printf("none");
+		else if (arg[0] == -2)
+			printf("ambiguous");
+		else
+			printf("item %d", arg[0]);
+		if (arg[1] == -1)
+			printf(" in the inventory\n");
+		else
+			printf(" in room %d\n", arg[1]);
+		break;
+	case TRACE_EVENT:
+		printf("event    %d %s in room %d\n", arg[0],
+			arg[1] >= OPEN && arg[1] <= TAKE ? event_types[arg[1]] : "?", arg[2]);
+		break;
+	case TRACE_STATE:
+		if (arg[0] == F_EXIT)
+			printf("state    exit %s of room %d = %d\n", dirs[arg[1] % 4], arg[1] / 4, arg[2]);
+		else if (arg[0] >= F_ROOM && arg[0] <= F_EXIT)
+			printf("state    %s %d = %d\n", fields[arg[0]], arg[1], arg[2]);
+		else
+			printf("state    field %d %d = %d\n", arg[0], arg[1], arg[2]);
+		break;
+	case TRACE_ROOM:
+		printf("room     %d -> %d\n", arg[0], arg[1]);
+		break;
+	default:
+		printf("type %u\n", record->type);
+		break;
+	}
+}
@@ -0,0 +1,847 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "forest.h"
+#include "world.h"
+#include "state.h"
+#include "rooms-desc.h"
+#include "items-desc.h"
+#include "inter-even.h"
+static void builtin_init(void);
+static int world_check(const struct world_source *source, char *error, size_t size);
+static int check_word(const char *word);
+static uint64_t section(uint64_t *offset, uint64_t count, size_t unit);
+static uint32_t pool_add(struct world_image *image, uint64_t *used, const char *string);
+static void world_layout(struct world_image *image);
+static void exit_index(struct world_image *image);
+static void chain_index(struct world_image *image);
+static unsigned chain_hash(int room, int item1, int item2);
+static int chain_find(const struct chain *chains, const int32_t *table, uint32_t mask,
+	int room, int item1, int item2);
+static void word_index(struct world_image *image);
+static int word_intern(struct world_image *image, const char *word);
+static unsigned word_hash(const char *word);
+static int word_find(const uint32_t *words, const int32_t *table, uint32_t mask,
+	const char *strings, const char *word, unsigned hash);
+static int section_ok(const struct world_image *image, uint64_t offset, uint64_t count, size_t unit);
+static int tables_ok(const struct world_image *image);
+static int indexes_ok(const struct world_image *image);
+static int layout_ok(const struct world_image *image);
+static int string_ok(const struct world_image *image, uint32_t offset, int needed);
+static uint64_t image_id(const struct world_image *image);
+
+/* interned before the items' words, see WORD_THE in world.h */
+static const char *function_words[] = {"the", "on", "at"};
+#define FUNCTION_WORDS ((int)(sizeof(function_words) / sizeof(function_words[0])))
+
+/* a section of a world image */
+#define SECTION(image, name, type) ((type *)((char *)(image) + (image)->name))
+
+static struct world builtin;
+static pthread_once_t builtin_once = PTHREAD_ONCE_INIT;
+static int builtin_failed;
+
+/* the world compiled in from the *-desc.h headers */
+extern const struct world *world_builtin(void)
+{
+	pthread_once(&builtin_once, builtin_init);
+	return builtin_failed ? NULL : &builtin;
+}
+
+static void builtin_init(void)
+{
+	struct world_source source = {
+		locations, items, interactions,
+		sizeof(locations) / sizeof(locations[0]),
+		sizeof(items) / sizeof(items[0]) - 1,	/* without the end markers */
+		sizeof(interactions) / sizeof(interactions[0]) - 1
+	};
+	struct world_image *image;
+	char error[200];
+
+	if ((image = world_build(&source, error, sizeof(error))) == NULL) {
+		fprintf(stderr, "forest: built-in world: %s\n", error);
+		builtin_failed = 1;
+	} else if (world_open(&builtin, image, image->size)) {
+		builtin_failed = 1;
+	}
+}
+
+/* map an image written by worldc; NULL with errno set if it can't be used */
+extern const struct world *world_load(const char *path)
+{
+	struct world *world;
+	struct stat st;
+	void *image;
+	int fd;
+
+	if ((fd = open(path, O_RDONLY)) == -1)
+		return NULL;
+	if (fstat(fd, &st) == -1 || (world = malloc(sizeof(*world))) == NULL) {
+		close(fd);
+		return NULL;
+	}
+	image = st.st_size == 0 ? MAP_FAILED : mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (image == MAP_FAILED) {
+		if (st.st_size == 0)
+			errno = EINVAL;
+		free(world);
+		return NULL;
+	}
+	if (world_open(world, image, st.st_size)) {
+		munmap(image, st.st_size);
+		free(world);
+		errno = EINVAL;
+		return NULL;
+	}
+	world->mapped = st.st_size;
+	return world;
+}
+
+/* once no game uses it */
+extern void world_unload(const struct world *world)
+{
+	if (world == NULL || world == &builtin)
+		return;
+	if (world->mapped)
+		munmap((void *)world->image, world->mapped);
+	free((void *)world);
+}
+
+/* Point a world at an image. Only the header is checked, in constant time:
+ * that every section lies inside the image and the state layout is the one
+ * this engine uses. The entries of the tables are trusted, as worldc checked
+ * them with world_verify() when it wrote the image.
+ */
+extern int world_open(struct world *world, const struct world_image *image, size_t size)
+{
+	uint64_t max_words;
+
+	if (size < sizeof(*image) || memcmp(image->magic, WORLD_MAGIC, sizeof(image->magic)) != 0 ||
+		image->version != WORLD_VERSION || image->byte_order != WORLD_BYTE_ORDER ||
+		image->size != size)
+		return 1;
+	if ((image->chain_mask & (image->chain_mask + 1)) != 0 ||
+		(image->word_mask & (image->word_mask + 1)) != 0)
+		return 1;
+	if (image->room_count < 1 || image->item_count < 0 || image->event_count < 0 ||
+		image->exit_count < 0 || image->chain_count < 0 || image->word_count < 0)
+		return 1;
+	max_words = 2 * (uint64_t)image->item_count + FUNCTION_WORDS;
+	if (!section_ok(image, image->rooms, image->room_count, sizeof(struct room)) ||
+		!section_ok(image, image->items, image->item_count, sizeof(struct item)) ||
+		!section_ok(image, image->events, image->event_count, sizeof(struct event)) ||
+		!section_ok(image, image->exit_slot, image->room_count * 4ull, sizeof(int32_t)) ||
+		!section_ok(image, image->chains, image->chain_count, sizeof(struct chain)) ||
+		!section_ok(image, image->chain_events, image->event_count, sizeof(int32_t)) ||
+		!section_ok(image, image->chain_table, image->chain_mask + 1ull, sizeof(int32_t)) ||
+		!section_ok(image, image->words, image->word_count, sizeof(uint32_t)) ||
+		!section_ok(image, image->word_table, image->word_mask + 1ull, sizeof(int32_t)) ||
+		!section_ok(image, image->item_adj, image->item_count, sizeof(int32_t)) ||
+		!section_ok(image, image->name_start, max_words + 1, sizeof(int32_t)) ||
+		!section_ok(image, image->name_items, image->item_count, sizeof(int32_t)) ||
+		!section_ok(image, image->strings, image->strings_size, 1) ||
+		image->strings_size == 0 || ((const char *)image)[image->strings + image->strings_size - 1] != '\0' ||
+		image->word_count > max_words || image->exit_count > image->room_count * 4ll)
+		return 1;
+	if (!layout_ok(image))
+		return 1;
+
+	world->image = image;
+	world->mapped = 0;
+	world->id = image->id;
+	world->strings = (const char *)image + image->strings;
+	world->rooms = (const struct room *)((const char *)image + image->rooms);
+	world->items = (const struct item *)((const char *)image + image->items);
+	world->events = (const struct event *)((const char *)image + image->events);
+	world->room_count = image->room_count;
+	world->item_count = image->item_count;
+	world->event_count = image->event_count;
+	world->exit_count = image->exit_count;
+	world->exit_slot = (const int32_t *)((const char *)image + image->exit_slot);
+	world->chain_count = image->chain_count;
+	world->chains = (const struct chain *)((const char *)image + image->chains);
+	world->chain_events = (const int32_t *)((const char *)image + image->chain_events);
+	world->chain_table = (const int32_t *)((const char *)image + image->chain_table);
+	world->chain_mask = image->chain_mask;
+	world->word_count = image->word_count;
+	world->words = (const uint32_t *)((const char *)image + image->words);
+	world->word_table = (const int32_t *)((const char *)image + image->word_table);
+	world->word_mask = image->word_mask;
+	world->item_adj = (const int32_t *)((const char *)image + image->item_adj);
+	world->name_start = (const int32_t *)((const char *)image + image->name_start);
+	world->name_items = (const int32_t *)((const char *)image + image->name_items);
+	world->state_size = image->state_size;
+	world->hidden = image->hidden;
+	world->inventory = image->inventory;
+	world->triggerable = image->triggerable;
+	world->locations = image->locations;
+	world->exits = image->exits;
+	world->room_first = image->room_first;
+	world->room_next = image->room_next;
+	world->inventory_first = image->inventory_first;
+	world->inventory_next = image->inventory_next;
+	return 0;
+}
+
+/* Check every entry the engine indexes with, as world_check() checks a
+ * source, and the id, so a damaged or made up image is found before it is
+ * read or written out of bounds. It reads the whole image: worldc does it
+ * when it writes one, and worldc -c on one from elsewhere.
+ */
+extern int world_verify(const struct world_image *image, size_t size)
+{
+	struct world world;
+
+	if (world_open(&world, image, size))
+		return 1;
+	return !tables_ok(image) || !indexes_ok(image) || image->id != image_id(image);
+}
+
+static int section_ok(const struct world_image *image, uint64_t offset, uint64_t count, size_t unit)
+{
+	return offset % 4 == 0 && offset <= image->size && count <= (image->size - offset) / unit;
+}
+
+/* the rooms, items and events, as world_check() has them */
+static int tables_ok(const struct world_image *image)
+{
+	const struct room *rooms = SECTION(image, rooms, const struct room);
+	const struct item *items = SECTION(image, items, const struct item);
+	const struct event *events = SECTION(image, events, const struct event);
+	const struct room *room;
+	const struct item *item;
+	const struct event *event;
+	int32_t room_count = image->room_count;
+	int32_t item_count = image->item_count;
+	int i;
+	int j;
+
+	for (i = 0; i < room_count; i++) {
+		room = &rooms[i];
+		if (!string_ok(image, room->room_name, 1) || !string_ok(image, room->room_desc, 1) ||
+			!string_ok(image, room->search_desc, 0))
+			return 0;
+		for (j = 0; j < 4; j++)
+			if (room->walk_to[j] < -1 || room->walk_to[j] >= room_count ||
+				!string_ok(image, room->walk_desc[j], 0))
+				return 0;
+	}
+	for (i = 0; i < item_count; i++) {
+		item = &items[i];
+		if (!string_ok(image, item->item_name, 1) || !string_ok(image, item->item_adj, 0) ||
+			!string_ok(image, item->item_desc_floor, 1) || !string_ok(image, item->item_desc_exam, 1) ||
+			(item->hidden != YES && item->hidden != NO) ||
+			(item->takeable != YES && item->takeable != NO) ||
+			item->location < -1 || item->location >= room_count)
+			return 0;
+	}
+	for (i = 0; i < image->event_count; i++) {
+		event = &events[i];
+		if (event->item1 < 0 || event->item1 >= item_count ||
+			event->item2 < -1 || event->item2 >= item_count ||
+			event->room_id < 0 || event->room_id >= room_count ||
+			(event->triggerable != YES && event->triggerable != NO) ||
+			(event->quit != YES && event->quit != NO) ||
+			event->event_link < -1 || event->event_link >= image->event_count ||
+			!string_ok(image, event->event_desc, 0))
+			return 0;
+		switch (event->event_type) {
+		case OPEN:
+			if (event->event_attr1 < 0 || event->event_attr1 >= room_count ||
+				event->event_dir < NORTH || event->event_dir > WEST ||
+				event->event_attr2 < -1 || event->event_attr2 >= room_count)
+				return 0;
+			break;
+		case CREATE:
+			if (event->event_attr2 < -1 || event->event_attr2 >= room_count)
+				return 0;
+			/* fall through */
+		case BREAK:
+		case TAKE:
+			if (event->event_attr1 < 0 || event->event_attr1 >= item_count)
+				return 0;
+			break;
+		case STORY:
+			if (event->event_attr1 < -3 || event->event_attr1 > 0)
+				return 0;
+			break;
+		default:
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/* the exit slots, chains and words: every entry in range, and every hash
+ * table with an empty bucket, so a lookup ends */
+static int indexes_ok(const struct world_image *image)
+{
+	const int32_t *exit_slot = SECTION(image, exit_slot, const int32_t);
+	const struct chain *chains = SECTION(image, chains, const struct chain);
+	const int32_t *chain_events = SECTION(image, chain_events, const int32_t);
+	const int32_t *chain_table = SECTION(image, chain_table, const int32_t);
+	const uint32_t *words = SECTION(image, words, const uint32_t);
+	const int32_t *word_table = SECTION(image, word_table, const int32_t);
+	const int32_t *item_adj = SECTION(image, item_adj, const int32_t);
+	const int32_t *name_start = SECTION(image, name_start, const int32_t);
+	const int32_t *name_items = SECTION(image, name_items, const int32_t);
+	const struct chain *chain;
+	int empty;
+	int64_t i;
+
+	for (i = 0; i < image->room_count * 4ll; i++)
+		if (exit_slot[i] < -1 || exit_slot[i] >= image->exit_count)
+			return 0;
+	for (i = 0; i < image->chain_count; i++) {
+		chain = &chains[i];
+		if (chain->room < 0 || chain->room >= image->room_count ||
+			chain->item1 < 0 || chain->item1 >= image->item_count ||
+			chain->item2 < -1 || chain->item2 >= image->item_count ||
+			chain->first < 0 || chain->count < 0 ||
+			(int64_t)chain->first + chain->count > image->event_count)
+			return 0;
+	}
+	for (i = 0; i < image->event_count; i++)
+		if (chain_events[i] < 0 || chain_events[i] >= image->event_count)
+			return 0;
+	for (empty = 0, i = 0; i <= image->chain_mask; i++) {
+		if (chain_table[i] < -1 || chain_table[i] >= image->chain_count)
+			return 0;
+		empty |= chain_table[i] == -1;
+	}
+	if (!empty)
+		return 0;
+
+	for (i = 0; i < image->word_count; i++)
+		if (!string_ok(image, words[i], 1))
+			return 0;
+	for (empty = 0, i = 0; i <= image->word_mask; i++) {
+		if (word_table[i] < -1 || word_table[i] >= image->word_count)
+			return 0;
+		empty |= word_table[i] == -1;
+	}
+	if (!empty)
+		return 0;
+	for (i = 0; i < image->item_count; i++)
+		if (item_adj[i] < -1 || item_adj[i] >= image->word_count ||
+			name_items[i] < 0 || name_items[i] >= image->item_count)
+			return 0;
+	if (name_start[0] < 0 || name_start[image->word_count] > image->item_count)
+		return 0;
+	for (i = 0; i < image->word_count; i++)
+		if (name_start[i] > name_start[i + 1])
+			return 0;
+	return 1;
+}
+
+/* the layout of struct state must be the one world_layout() gives */
+static int layout_ok(const struct world_image *image)
+{
+	struct world_image layout = *image;
+
+	world_layout(&layout);
+	return image->state_size == layout.state_size && image->hidden == layout.hidden &&
+		image->inventory == layout.inventory && image->triggerable == layout.triggerable &&
+		image->locations == layout.locations && image->exits == layout.exits &&
+		image->room_first == layout.room_first && image->room_next == layout.room_next &&
+		image->inventory_first == layout.inventory_first &&
+		image->inventory_next == layout.inventory_next;
+}
+
+/* an offset into the string pool, which ends in a NUL; 0 only if not needed */
+static int string_ok(const struct world_image *image, uint32_t offset, int needed)
+{
+	return offset < image->strings_size && (offset != 0 || !needed);
+}
+
+/* Check a world and build its image, with every index precomputed, in one
+ * block from malloc(). On error, returns NULL and describes it in error.
+ */
+extern struct world_image *world_build(const struct world_source *source, char *error, size_t size)
+{
+	struct world_image header;
+	struct world_image *image;
+	struct room *room;
+	struct item *item;
+	struct event *event;
+	const struct room_desc *rd;
+	const struct item_desc *id;
+	const struct event_desc *ed;
+	uint64_t offset;
+	uint64_t used;
+	uint64_t strings;
+	int max_words;
+	int i;
+	int j;
+
+	if (world_check(source, error, size))
+		return NULL;
+
+	/* every string once, after an empty one for offset 0 */
+	for (strings = 1, i = 0; i < source->room_count; i++) {
+		rd = &source->rooms[i];
+		strings += strlen(rd->room_name) + strlen(rd->room_desc) + 2;
+		for (j = 0; j < 4; j++)
+			if (rd->walk_desc[j] != NULL)
+				strings += strlen(rd->walk_desc[j]) + 1;
+		if (rd->search_desc != NULL)
+			strings += strlen(rd->search_desc) + 1;
+	}
+	for (i = 0; i < source->item_count; i++) {
+		id = &source->items[i];
+		strings += strlen(id->item_name) + strlen(id->item_desc_floor) + strlen(id->item_desc_exam) + 3;
+		if (id->item_adj != NULL)
+			strings += strlen(id->item_adj) + 1;
+	}
+	for (i = 0; i < FUNCTION_WORDS; i++)
+		strings += strlen(function_words[i]) + 1;
+	for (i = 0; i < source->event_count; i++)
+		if (source->events[i].event_desc != NULL)
+			strings += strlen(source->events[i].event_desc) + 1;
+
+	/* lay out the sections, using upper bounds for the index sizes */
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, WORLD_MAGIC, sizeof(header.magic));
+	header.version = WORLD_VERSION;
+	header.byte_order = WORLD_BYTE_ORDER;
+	header.room_count = source->room_count;
+	header.item_count = source->item_count;
+	header.event_count = source->event_count;
+	for (header.chain_mask = 15; header.chain_mask < 2 * (uint32_t)source->event_count;)
+		header.chain_mask = header.chain_mask * 2 + 1;
+	for (header.word_mask = 15; header.word_mask < 4 * (uint32_t)source->item_count + FUNCTION_WORDS;)
+		header.word_mask = header.word_mask * 2 + 1;
+	max_words = 2 * source->item_count + FUNCTION_WORDS;
+	offset = sizeof(header);
+	header.rooms = section(&offset, source->room_count, sizeof(struct room));
+	header.items = section(&offset, source->item_count, sizeof(struct item));
+	header.events = section(&offset, source->event_count, sizeof(struct event));
+	header.exit_slot = section(&offset, source->room_count * 4, sizeof(int32_t));
+	header.chains = section(&offset, source->event_count, sizeof(struct chain));
+	header.chain_events = section(&offset, source->event_count, sizeof(int32_t));
+	header.chain_table = section(&offset, header.chain_mask + 1ull, sizeof(int32_t));
+	header.words = section(&offset, max_words, sizeof(uint32_t));
+	header.word_table = section(&offset, header.word_mask + 1ull, sizeof(int32_t));
+	header.item_adj = section(&offset, source->item_count, sizeof(int32_t));
+	header.name_start = section(&offset, max_words + 1, sizeof(int32_t));
+	header.name_items = section(&offset, source->item_count, sizeof(int32_t));
+	header.strings = section(&offset, strings, 1);
+	header.strings_size = strings;
+	header.size = section(&offset, 0, 1);
+	if ((image = calloc(1, header.size)) == NULL) {
+		snprintf(error, size, "out of memory");
+		return NULL;
+	}
+	*image = header;
+
+	/* the tables, with their strings moved to the pool */
+	used = 1;
+	for (i = 0; i < source->room_count; i++) {
+		rd = &source->rooms[i];
+		room = &SECTION(image, rooms, struct room)[i];
+		room->room_id = rd->room_id;
+		room->room_name = pool_add(image, &used, rd->room_name);
+		room->room_desc = pool_add(image, &used, rd->room_desc);
+		for (j = 0; j < 4; j++) {
+			room->walk_to[j] = rd->walk_to[j];
+			room->walk_desc[j] = pool_add(image, &used, rd->walk_desc[j]);
+		}
+		room->search_desc = pool_add(image, &used, rd->search_desc);
+	}
+	for (i = 0; i < source->item_count; i++) {
+		id = &source->items[i];
+		item = &SECTION(image, items, struct item)[i];
+		item->item_id = id->item_id;
+		item->item_name = pool_add(image, &used, id->item_name);
+		item->item_adj = pool_add(image, &used, id->item_adj);
+		item->item_desc_floor = pool_add(image, &used, id->item_desc_floor);
+		item->item_desc_exam = pool_add(image, &used, id->item_desc_exam);
+		item->hidden = id->hidden;
+		item->takeable = id->takeable;
+		item->location = id->location;
+	}
+	for (i = 0; i < source->event_count; i++) {
+		ed = &source->events[i];
+		event = &SECTION(image, events, struct event)[i];
+		event->event_id = ed->event_id;
+		event->item1 = ed->item1;
+		event->item2 = ed->item2;
+		event->room_id = ed->room_id;
+		event->triggerable = ed->triggerable;
+		event->event_type = ed->event_type;
+		event->event_dir = ed->event_dir;
+		event->event_attr1 = ed->event_attr1;
+		event->event_attr2 = ed->event_attr2;
+		event->event_link = ed->event_link;
+		event->quit = ed->quit;
+		event->event_desc = pool_add(image, &used, ed->event_desc);
+	}
+	for (i = 0; i < FUNCTION_WORDS; i++)
+		SECTION(image, words, uint32_t)[i] = pool_add(image, &used, function_words[i]);
+
+	exit_index(image);
+	chain_index(image);
+	word_index(image);
+	world_layout(image);
+	image->id = image_id(image);
+	return image;
+}
+
+/* a checksum of everything after the id field, header counts included */
+static uint64_t image_id(const struct world_image *image)
+{
+	size_t start = offsetof(struct world_image, id) + sizeof(image->id);
+
+	return world_checksum((const char *)image + start, image->size - start);
+}
+
+/* reserve count units at offset, 8-byte aligned, and return where they start */
+static uint64_t section(uint64_t *offset, uint64_t count, size_t unit)
+{
+	uint64_t start = (*offset + 7) & ~(uint64_t)7;
+
+	*offset = start + count * unit;
+	return start;
+}
+
+static uint32_t pool_add(struct world_image *image, uint64_t *used, const char *string)
+{
+	uint32_t offset = *used;
+
+	if (string == NULL)
+		return 0;
+	strcpy(SECTION(image, strings, char) + offset, string);
+	*used += strlen(string) + 1;
+	return offset;
+}
+
+/* everything the engine relies on, so a built image needs no more checks */
+static int world_check(const struct world_source *source, char *error, size_t size)
+{
+	const struct room_desc *room;
+	const struct item_desc *item;
+	const struct event_desc *event;
+	int rooms = source->room_count;
+	int items = source->item_count;
+	int i;
+	int j;
+
+#define BAD(kind, problem) do { \
+		snprintf(error, size, "%s %d: %s", kind, i, problem); \
+		return 1; \
+	} while (0)
+	if (rooms < 1) {
+		snprintf(error, size, "there are no rooms");
+		return 1;
+	}
+	for (i = 0; i < rooms; i++) {
+		room = &source->rooms[i];
+		if (room->room_id != i)
+			BAD("room", "ids must count up from 0");
+		if (room->room_name == NULL || room->room_desc == NULL)
+			BAD("room", "no name or description");
+		for (j = 0; j < 4; j++)
+			if (room->walk_to[j] < -1 || room->walk_to[j] >= rooms)
+				BAD("room", "exit leads to a room that does not exist");
+	}
+	for (i = 0; i < items; i++) {
+		item = &source->items[i];
+		if (item->item_id != i)
+			BAD("item", "ids must count up from 0");
+		if (item->item_desc_floor == NULL || item->item_desc_exam == NULL)
+			BAD("item", "no floor or examine description");
+		if (item->item_name == NULL || !check_word(item->item_name) ||
+			(item->item_adj != NULL && !check_word(item->item_adj)))
+			BAD("item", "name or adjective is not one lowercase word");
+		if ((item->hidden != YES && item->hidden != NO) ||
+			(item->takeable != YES && item->takeable != NO))
+			BAD("item", "hidden and takeable must be yes or no");
+		if (item->location < -1 || item->location >= rooms)
+			BAD("item", "in a room that does not exist");
+	}
+	for (i = 0; i < source->event_count; i++) {
+		event = &source->events[i];
+		if (event->event_id != i)
+			BAD("event", "ids must count up from 0");
+		if (event->item1 < 0 || event->item1 >= items || event->item2 < -1 || event->item2 >= items)
+			BAD("event", "uses an item that does not exist");
+		if (event->room_id < 0 || event->room_id >= rooms)
+			BAD("event", "in a room that does not exist");
+		if ((event->triggerable != YES && event->triggerable != NO) ||
+			(event->quit != YES && event->quit != NO))
+			BAD("event", "triggerable and quit must be yes or no");
+		if (event->event_link < -1 || event->event_link >= source->event_count)
+			BAD("event", "links to an event that does not exist");
+		switch (event->event_type) {
+		case OPEN:
+			if (event->event_attr1 < 0 || event->event_attr1 >= rooms ||
+				event->event_dir < NORTH || event->event_dir > WEST ||
+				event->event_attr2 < -1 || event->event_attr2 >= rooms)
+				BAD("event", "opens an exit that does not exist");
+			break;
+		case CREATE:
+			if (event->event_attr2 < -1 || event->event_attr2 >= rooms)
+				BAD("event", "creates an item in a room that does not exist");
+			/* fall through */
+		case BREAK:
+		case TAKE:
+			if (event->event_attr1 < 0 || event->event_attr1 >= items)
+				BAD("event", "acts on an item that does not exist");
+			break;
+		case STORY:
+			if (event->event_attr1 < -3 || event->event_attr1 > 0)
+				BAD("event", "story must set the status to 0, -1, -2 or -3");
+			break;
+		default:
+			BAD("event", "unknown type");
+		}
+	}
+#undef BAD
+	return 0;
+}
+
+/* commands are lowercased and split on spaces, so only such words match */
+static int check_word(const char *word)
+{
+	if (*word == '\0')
+		return 0;
+	for (; *word != '\0'; word++)
+		if (*word == ' ' || *word == '\n' || (*word >= 'A' && *word <= 'Z'))
+			return 0;
+	return 1;
+}
+
+/* exits that OPEN events can change get a slot in the game state */
+static void exit_index(struct world_image *image)
+{
+	const struct event *events = SECTION(image, events, struct event);
+	int32_t *exit_slot = SECTION(image, exit_slot, int32_t);
+	int i;
+	int slot;
+
+	for (i = 0; i < image->room_count * 4; i++)
+		exit_slot[i] = -1;
+	for (image->exit_count = 0, i = 0; i < image->event_count; i++) {
+		if (events[i].event_type == OPEN) {
+			slot = events[i].event_attr1 * 4 + events[i].event_dir;
+			if (exit_slot[slot] == -1)
+				exit_slot[slot] = image->exit_count++;
+		}
+	}
+}
+
+/* the layout of struct state for this world */
+static void world_layout(struct world_image *image)
+{
+	size_t words;
+
+	words = offsetof(struct state, bits) / sizeof(uint64_t);
+	image->hidden = 0;
+	image->inventory = image->hidden + BITSET_WORDS(image->item_count);
+	image->triggerable = image->inventory + BITSET_WORDS(image->item_count);
+	words += image->triggerable + BITSET_WORDS(image->event_count);
+	image->locations = words * sizeof(uint64_t);
+	image->exits = image->locations + image->item_count * sizeof(int32_t);
+	image->room_first = image->exits + image->exit_count * sizeof(int32_t);
+	image->room_next = image->room_first + image->room_count * sizeof(int32_t);
+	image->inventory_first = image->room_next + image->item_count * sizeof(int32_t);
+	image->inventory_next = image->inventory_first + sizeof(int32_t);
+	image->state_size = image->inventory_next + image->item_count * sizeof(int32_t);
+}
+
+/* Group the events by (room, item1, item2). interact() only ever fires
+ * events whose triple matches, so walking a chain in table order is the
+ * same as scanning the whole table.
+ */
+static void chain_index(struct world_image *image)
+{
+	const struct event *events = SECTION(image, events, struct event);
+	const struct event *event;
+	struct chain *chains = SECTION(image, chains, struct chain);
+	int32_t *chain_events = SECTION(image, chain_events, int32_t);
+	int32_t *table = SECTION(image, chain_table, int32_t);
+	struct chain *chain;
+	uint32_t i;
+	int c;
+
+	for (i = 0; i <= image->chain_mask; i++)
+		table[i] = -1;
+
+	/* find the chains and count their events */
+	image->chain_count = 0;
+	for (i = 0; i < image->event_count; i++) {
+		event = &events[i];
+		if ((c = chain_find(chains, table, image->chain_mask,
+			event->room_id, event->item1, event->item2)) < 0) {
+			table[-c - 2] = image->chain_count;
+			chain = &chains[image->chain_count++];
+			chain->room = event->room_id;
+			chain->item1 = event->item1;
+			chain->item2 = event->item2;
+			chain->count = 0;
+		} else {
+			chain = &chains[c];
+		}
+		chain->count++;
+	}
+	for (c = 0, i = 0; c < image->chain_count; c++) {
+		chains[c].first = i;
+		i += chains[c].count;
+		chains[c].count = 0;
+	}
+
+	/* then list them, still in table order */
+	for (i = 0; i < image->event_count; i++) {
+		event = &events[i];
+		chain = &chains[chain_find(chains, table, image->chain_mask,
+			event->room_id, event->item1, event->item2)];
+		chain_events[chain->first + chain->count++] = i;
+	}
+}
+
+static unsigned chain_hash(int room, int item1, int item2)
+{
+	uint64_t x;
+
+	x = (uint32_t)room * 0x9e3779b97f4a7c15 ^ ((uint64_t)(uint32_t)item1 << 32 | (uint32_t)item2);
+	x = (x ^ (x >> 31)) * 0xbf58476d1ce4e5b9;
+	return x ^ (x >> 32);
+}
+
+/* the chain for a triple, or -(empty bucket)-2 if there is none */
+static int chain_find(const struct chain *chains, const int32_t *table, uint32_t mask,
+	int room, int item1, int item2)
+{
+	const struct chain *chain;
+	unsigned h;
+	int c;
+
+	for (h = chain_hash(room, item1, item2) & mask; (c = table[h]) != -1; h = (h + 1) & mask) {
+		chain = &chains[c];
+		if (chain->room == room && chain->item1 == item1 && chain->item2 == item2)
+			return c;
+	}
+	return -(int)h - 2;
+}
+
+/* the events that using item1 on item2 in a room may fire, or NULL */
+extern const struct chain *world_chain(const struct world *world, int room, int item1, int item2)
+{
+	int c = chain_find(world->chains, world->chain_table, world->chain_mask, room, item1, item2);
+
+	return c < 0 ? NULL : &world->chains[c];
+}
+
+/* Intern the words commands are made of - the function words, then every
+ * item name and adjective - and list the items by name, so finding "red
+ * coin" is two lookups and a walk over the coins. The function words are
+ * already in the pool.
+ */
+static void word_index(struct world_image *image)
+{
+	const struct item *items = SECTION(image, items, struct item);
+	const char *strings = SECTION(image, strings, char);
+	int32_t *table = SECTION(image, word_table, int32_t);
+	int32_t *item_adj = SECTION(image, item_adj, int32_t);
+	int32_t *name_start = SECTION(image, name_start, int32_t);
+	int32_t *name_items = SECTION(image, name_items, int32_t);
+	uint32_t i;
+	int t;
+
+	for (i = 0; i <= image->word_mask; i++)
+		table[i] = -1;
+	image->word_count = 0;
+	for (i = 0; i < FUNCTION_WORDS; i++)
+		word_intern(image, strings + SECTION(image, words, uint32_t)[i]);
+
+	/* count the items by name */
+	for (i = 0; i < image->item_count; i++) {
+		name_start[word_intern(image, strings + items[i].item_name) + 1]++;
+		item_adj[i] = items[i].item_adj == 0 ? -1 : word_intern(image, strings + items[i].item_adj);
+	}
+
+	/* then list them, in table order */
+	for (t = 0; t < image->word_count; t++)
+		name_start[t + 1] += name_start[t];
+	for (i = 0; i < image->item_count; i++)
+		name_items[name_start[word_intern(image, strings + items[i].item_name)]++] = i;
+	for (t = image->word_count; t > 0; t--)
+		name_start[t] = name_start[t - 1];
+	name_start[0] = 0;
+}
+
+/* the token of a word, adding it if it is new; the word is in the pool */
+static int word_intern(struct world_image *image, const char *word)
+{
+	const char *strings = SECTION(image, strings, char);
+	uint32_t *words = SECTION(image, words, uint32_t);
+	int32_t *table = SECTION(image, word_table, int32_t);
+	int t;
+
+	if ((t = word_find(words, table, image->word_mask, strings, word, word_hash(word))) < 0) {
+		table[-t - 2] = image->word_count;
+		words[image->word_count] = word - strings;
+		t = image->word_count++;
+	}
+	return t;
+}
+
+static unsigned word_hash(const char *word)
+{
+	unsigned h = WORD_HASH_START;
+
+	while (*word != '\0')
+		h = WORD_HASH_STEP(h, *word++);
+	return h;
+}
+
+/* the token of a word, or -(empty bucket)-2 if it is not known */
+static int word_find(const uint32_t *words, const int32_t *table, uint32_t mask,
+	const char *strings, const char *word, unsigned hash)
+{
+	unsigned h;
+	int t;
+
+	for (h = (hash ^ hash >> 16) & mask; (t = table[h]) != -1; h = (h + 1) & mask) {
+		if (strcmp(strings + words[t], word) == 0)
+			return t;
+	}
+	return -(int)h - 2;
+}
+
+/* The token of a word, -1 if no item uses it and it is not a function
+ * word. hash is the word's WORD_HASH, which callers get while reading it.
+ */
+extern int world_word(const struct world *world, const char *word, unsigned hash)
+{
+	int t = word_find(world->words, world->word_table, world->word_mask,
+		world->strings, word, hash);
+
+	return t < 0 ? -1 : t;
+}
+
+/* FNV-1a a 64-bit word at a time, then the odd bytes */
+extern uint64_t world_checksum(const void *data, size_t size)
+{
+	const unsigned char *p = data;
+	uint64_t h = 0xcbf29ce484222325;
+	uint64_t word;
+
+	for (; size >= 8; p += 8, size -= 8) {
+		memcpy(&word, p, 8);
+		h = (h ^ word) * 0x100000001b3;
+	}
+	for (; size > 0; p++, size--)
+		h = (h ^ *p) * 0x100000001b3;
+	return h ^ h >> 32;
+}
@@ -0,0 +1,254 @@
+#ifndef WORLD_H
+#define WORLD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* A world as it is written: the built-in one in the *-desc.h headers, or
+ * one read by worldc. world_build() checks it and turns it into an image.
+ */
+
+struct room_desc {
+	int room_id;
+	const char *room_name;
+	const char *room_desc;
+	int walk_to[4];
+	const char *walk_desc[4];
+	const char *search_desc;
+};
+
+struct item_desc {
+	int item_id;
+	const char *item_name;
+	const char *item_adj;
+	const char *item_desc_floor;
+	const char *item_desc_exam;
+	int hidden;
+	int takeable;
+	int location;
+};
+
+struct event_desc {
+	int event_id;
+	int item1;
+	int item2;
+	int room_id;
+	int triggerable;
+	int event_type;
+	int event_dir;
+	int event_attr1;
+	int event_attr2;
+	int event_link;
+	int quit;
+	const char *event_desc;
+};
+
+struct world_source {
+	const struct room_desc *rooms;
+	const struct item_desc *items;
+	const struct event_desc *events;
+	int room_count;
+	int item_count;
+	int event_count;
+};
+
+#define NO 0
+#define YES 1
+
+#define OPEN 0
+#define BREAK 1
+#define CREATE 2
+#define STORY 3
+#define TAKE 4
+
+#define NORTH 0
+#define EAST 1
+#define SOUTH 2
+#define WEST 3
+
+/* The tables of a world image, read-only and shared by every game. Strings
+ * are offsets into the image's string pool, 0 for none. The fields that
+ * change during play (walk_to, hidden, location, triggerable) hold their
+ * starting values; the current values live in each game's struct state.
+ */
+
+struct room {
+	int32_t room_id;
+	uint32_t room_name;
+	uint32_t room_desc;
+	int32_t walk_to[4];
+	uint32_t walk_desc[4];
+	uint32_t search_desc;
+};
+
+struct item {
+	int32_t item_id;
+	uint32_t item_name;
+	uint32_t item_adj;
+	uint32_t item_desc_floor;
+	uint32_t item_desc_exam;
+	int32_t hidden;
+	int32_t takeable;
+	int32_t location;
+};
+
+struct event {
+	int32_t event_id;
+	int32_t item1;
+	int32_t item2;
+	int32_t room_id;
+	int32_t triggerable;
+	int32_t event_type;
+	int32_t event_dir;
+	int32_t event_attr1;
+	int32_t event_attr2;
+	int32_t event_link;
+	int32_t quit;
+	uint32_t event_desc;
+};
+
+/* the events for one (room, item1, item2), in table order */
+struct chain {
+	int32_t room;
+	int32_t item1;
+	int32_t item2;
+	int32_t first;			/* into world.chain_events */
+	int32_t count;
+};
+
+/* A world image: this header, then the sections it gives the byte offsets
+ * of. It holds no pointers, so it can be written to a file by worldc and
+ * mapped back in by world_load() as it is.
+ */
+#define WORLD_MAGIC "forestw"
+#define WORLD_VERSION 2
+#define WORLD_BYTE_ORDER 0x01020304
+
+struct world_image {
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order;
+	uint64_t size;
+	uint64_t id;			/* checksum of the image after this field */
+
+	int32_t room_count;
+	int32_t item_count;
+	int32_t event_count;
+	int32_t exit_count;
+	int32_t chain_count;
+	int32_t word_count;
+	uint32_t chain_mask;
+	uint32_t word_mask;
+
+	/* sections */
+	uint64_t rooms;
+	uint64_t items;
+	uint64_t events;
+	uint64_t exit_slot;
+	uint64_t chains;
+	uint64_t chain_events;
+	uint64_t chain_table;
+	uint64_t words;
+	uint64_t word_table;
+	uint64_t item_adj;
+	uint64_t name_start;
+	uint64_t name_items;
+	uint64_t strings;
+	uint64_t strings_size;
+
+	/* layout of struct state, as in struct world */
+	uint64_t state_size;
+	uint64_t hidden;
+	uint64_t inventory;
+	uint64_t triggerable;
+	uint64_t locations;
+	uint64_t exits;
+	uint64_t room_first;
+	uint64_t room_next;
+	uint64_t inventory_first;
+	uint64_t inventory_next;
+};
+
+/* a world image opened for play */
+struct world {
+	const struct world_image *image;
+	size_t mapped;			/* length of the mapping, 0 if not mapped */
+	uint64_t id;			/* the image's id, see world_id() */
+	const char *strings;
+
+	const struct room *rooms;
+	const struct item *items;
+	const struct event *events;
+	int room_count;
+	int item_count;
+	int event_count;
+
+	/* exits that OPEN events can change get a slot in the game state */
+	int exit_count;
+	const int32_t *exit_slot;	/* room*4+dir ==> slot, or -1 */
+
+	/* events grouped by what triggers them, see world_chain() */
+	int chain_count;
+	const struct chain *chains;
+	const int32_t *chain_events;	/* event ids, chain by chain */
+	const int32_t *chain_table;	/* open addressing, hash ==> chain or -1 */
+	uint32_t chain_mask;
+
+	/* item names, adjectives and function words interned to tokens */
+	int word_count;
+	const uint32_t *words;		/* token ==> word */
+	const int32_t *word_table;	/* open addressing, hash ==> token or -1 */
+	uint32_t word_mask;
+	const int32_t *item_adj;	/* item ==> token of its adjective, or -1 */
+	const int32_t *name_start;	/* token ==> first of its items in name_items */
+	const int32_t *name_items;	/* item ids, grouped by the token of their name */
+
+	/* layout of struct state */
+	size_t state_size;
+	size_t hidden;			/* word offsets of the bitsets */
+	size_t inventory;
+	size_t triggerable;
+	size_t locations;		/* byte offsets of the int32_t tables */
+	size_t exits;
+	size_t room_first;		/* sorted lists of the items in each room, */
+	size_t room_next;		/* and in the inventory: first item, then */
+	size_t inventory_first;		/* next item, -1 at the end */
+	size_t inventory_next;
+};
+
+/* a word of a command and its token in the world's vocabulary, -1 if none */
+struct word {
+	const char *text;
+	int token;
+};
+
+/* tokens of the function words, which come before the items' words */
+#define WORD_THE 0
+#define WORD_ON 1
+#define WORD_AT 2
+
+/* FNV-1a, as used to look words up */
+#define WORD_HASH_START 2166136261u
+#define WORD_HASH_STEP(h, c) (((h) ^ (unsigned char)(c)) * 16777619u)
+
+extern const struct world *world_builtin(void);
+extern struct world_image *world_build(const struct world_source *source, char *error, size_t size);
+extern int world_open(struct world *world, const struct world_image *image, size_t size);
+extern int world_verify(const struct world_image *image, size_t size);
+extern int world_word(const struct world *world, const char *word, unsigned hash);
+extern const struct chain *world_chain(const struct world *world, int room, int item1, int item2);
+extern uint64_t world_checksum(const void *data, size_t size);
+
+/* which world a saved game or a recording belongs to */
+static inline uint64_t world_id(const struct world *world)
+{
+	return world->id;
+}
+
+/* a string of the world, NULL for none */
+static inline const char *world_string(const struct world *world, uint32_t offset)
+{
+	return offset == 0 ? NULL : world->strings + offset;
+}
+
+#endif
@@ -0,0 +1,470 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include "forest.h"
+#include "world.h"
+int main(int argc, char *argv[]);
+static int compile(const char *source, const char *output);
+static int parse_line(char *line);
+static char *text(const char *value);
+static int number(const char *value, int *n);
+static int yes_no(const char *value, int *n);
+static int direction(const char *value);
+static const char *next_word(const char *value);
+static int decompile(const struct world *world);
+static void put_text(const char *key, const char *text);
+
+/* worldc - compile a world description into an image forest can load
+ *
+ *	worldc source image	check source and write its image
+ *	worldc -c image		check every table of an image, which forest
+ *				trusts when it loads one
+ *	worldc -d [image]	print an image, or the built-in world, as source
+ *
+ * A source is a list of records, each a line of its own followed by its
+ * fields, one per line and indented; blank lines and lines starting with #
+ * are skipped. Text runs to the end of the line, with \n for a line break
+ * and \\ for a backslash.
+ * Ids count up from 0 in each kind of record, and refer to rooms, items
+ * and events by number; -1 is none.
+ *
+ *	room id
+ *		name text
+ *		desc text
+ *		north|east|south|west room [text said when walking there]
+ *		search text
+ *	item id
+ *		name word
+ *		adj word
+ *		floor text		shown in the room
+ *		examine text
+ *		hidden yes|no
+ *		takeable yes|no
+ *		location room
+ *	event id
+ *		use item [item]
+ *		room room
+ *		triggerable yes|no
+ *		open room north|east|south|west room
+ *		break item
+ *		create item room
+ *		story status		0 goes on, -1 quit, -2 bad and -3 good ending
+ *		take item
+ *		link event		toggled when this one fires
+ *		quit yes|no		no goes on to the next matching event
+ *		desc text
+ */
+
+static const char *dirs[4] = {"north", "east", "south", "west"};
+
+/* the world being read */
+static struct room_desc *rooms;
+static struct item_desc *items;
+static struct event_desc *events;
+static int room_count;
+static int item_count;
+static int event_count;
+static int record;	/* ROOM, ITEM or EVENT: what the fields belong to */
+static const char *problem;
+
+enum { NOTHING, ROOM, ITEM, EVENT };
+
+int main(int argc, char *argv[])
+{
+	const struct world *world;
+
+	if (argc == 3 && strcmp(argv[1], "-c") == 0) {
+		if ((world = world_load(argv[2])) == NULL || world_verify(world->image, world->image->size)) {
+			fprintf(stderr, "worldc: %s: %s\n", argv[2],
+				world == NULL && errno != EINVAL ? strerror(errno) : "not a world image");
+			return 1;
+		}
+		return 0;
+	}
+	if (argc == 3 && strcmp(argv[1], "-d") != 0)
+		return compile(argv[1], argv[2]);
+	if (argc >= 2 && argc <= 3 && strcmp(argv[1], "-d") == 0) {
+		if (argc == 2) {
+			world = world_builtin();
+		} else if ((world = world_load(argv[2])) == NULL) {
+			fprintf(stderr, "worldc: %s: %s\n", argv[2],
+				errno == EINVAL ? "not a world image" : strerror(errno));
+			return 1;
+		}
+		return decompile(world);
+	}
+	fprintf(stderr, "usage: worldc source image\n       worldc -c image\n       worldc -d [image]\n");
+	return 1;
+}
+
+static int compile(const char *source, const char *output)
+{
+	struct world_source world;
+	struct world_image *image;
+	FILE *in;
+	FILE *out;
+	char *line = NULL;
+	size_t size = 0;
+	ssize_t len;
+	int lineno;
+	char error[200];
+
+	if ((in = fopen(source, "r")) == NULL) {
+		fprintf(stderr, "worldc: %s: %s\n", source, strerror(errno));
+		return 1;
+	}
+	for (lineno = 1; (len = getline(&line, &size, in)) != -1; lineno++) {
+		while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+			line[--len] = '\0';
+		if (parse_line(line)) {
+			fprintf(stderr, "worldc: %s:%d: %s\n", source, lineno, problem);
+			return 1;
+		}
+	}
+	fclose(in);
+
+	world.rooms = rooms;
+	world.items = items;
+	world.events = events;
+	world.room_count = room_count;
+	world.item_count = item_count;
+	world.event_count = event_count;
+	if ((image = world_build(&world, error, sizeof(error))) == NULL) {
+		fprintf(stderr, "worldc: %s: %s\n", source, error);
+		return 1;
+	}
+	if (world_verify(image, image->size)) {
+		fprintf(stderr, "worldc: %s: built a bad image\n", source);
+		return 1;
+	}
+	if ((out = fopen(output, "wb")) == NULL ||
+		fwrite(image, 1, image->size, out) != image->size || fclose(out) != 0) {
+		fprintf(stderr, "worldc: %s: %s\n", output, strerror(errno));
+		remove(output);
+		return 1;
+	}
+	return 0;
+}
+
+/* one line of a source; on error, says what is wrong in problem */
+static int parse_line(char *line)
+{
+	struct room_desc *room = room_count > 0 ? &rooms[room_count - 1] : NULL;
+	struct item_desc *item = item_count > 0 ? &items[item_count - 1] : NULL;
+	struct event_desc *event = event_count > 0 ? &events[event_count - 1] : NULL;
+	char *key;
+	char *value;
+	int indented;
+	const char *arg;
+	const char *arg2;
+	void *grown;
+	int n;
+	int d;
+
+	indented = *line == ' ' || *line == '\t';
+	while (*line == ' ' || *line == '\t')
+		line++;
+	if (*line == '\0' || *line == '#')
+		return 0;
+
+	/* split into key and value */
+	key = line;
+	line += strcspn(line, " \t");
+	if (*line != '\0')
+		*line++ = '\0';
+	value = line + strspn(line, " \t");
+
+	/* a new record */
+	if (!indented) {
+		if (number(value, &n))
+			return 1;
+		if (strcmp(key, "room") == 0) {
+			if ((grown = realloc(rooms, (room_count + 1) * sizeof(*rooms))) == NULL)
+				goto memory;
+			rooms = grown;
+			room = &rooms[room_count++];
+			memset(room, 0, sizeof(*room));
+			room->room_id = n;
+			for (d = 0; d < 4; d++)
+				room->walk_to[d] = -1;
+			record = ROOM;
+		} else if (strcmp(key, "item") == 0) {
+			if ((grown = realloc(items, (item_count + 1) * sizeof(*items))) == NULL)
+				goto memory;
+			items = grown;
+			item = &items[item_count++];
+			memset(item, 0, sizeof(*item));
+			item->item_id = n;
+			item->hidden = NO;
+			item->takeable = NO;
+			item->location = -1;
+			record = ITEM;
+		} else if (strcmp(key, "event") == 0) {
+			if ((grown = realloc(events, (event_count + 1) * sizeof(*events))) == NULL)
+				goto memory;
+			events = grown;
+			event = &events[event_count++];
+			memset(event, 0, sizeof(*event));
+			event->event_id = n;
+			event->item1 = -1;
+			event->item2 = -1;
+			event->room_id = -1;
+			event->triggerable = YES;
+			event->event_type = -1;
+			event->event_attr2 = -1;
+			event->event_link = -1;
+			event->quit = YES;
+			record = EVENT;
+		} else {
+			problem = "expected room, item or event";
+			return 1;
+		}
+		return 0;
+	}
+
+	/* the value's second and third words, if it has them */
+	arg = next_word(value);
+	arg2 = next_word(arg);
+
+	if (record == ROOM) {
+		if (strcmp(key, "name") == 0) {
+			return (room->room_name = text(value)) == NULL;
+		} else if (strcmp(key, "desc") == 0) {
+			return (room->room_desc = text(value)) == NULL;
+		} else if (strcmp(key, "search") == 0) {
+			return (room->search_desc = text(value)) == NULL;
+		} else if ((d = direction(key)) != -1) {
+			if (number(value, &room->walk_to[d]))
+				return 1;
+			return *arg != '\0' && (room->walk_desc[d] = text(arg)) == NULL;
+		}
+	} else if (record == ITEM) {
+		if (strcmp(key, "name") == 0) {
+			return (item->item_name = text(value)) == NULL;
+		} else if (strcmp(key, "adj") == 0) {
+			return (item->item_adj = text(value)) == NULL;
+		} else if (strcmp(key, "floor") == 0) {
+			return (item->item_desc_floor = text(value)) == NULL;
+		} else if (strcmp(key, "examine") == 0) {
+			return (item->item_desc_exam = text(value)) == NULL;
+		} else if (strcmp(key, "hidden") == 0) {
+			return yes_no(value, &item->hidden);
+		} else if (strcmp(key, "takeable") == 0) {
+			return yes_no(value, &item->takeable);
+		} else if (strcmp(key, "location") == 0) {
+			return number(value, &item->location);
+		}
+	} else if (record == EVENT) {
+		if (strcmp(key, "use") == 0) {
+			return number(value, &event->item1) || (*arg != '\0' && number(arg, &event->item2));
+		} else if (strcmp(key, "room") == 0) {
+			return number(value, &event->room_id);
+		} else if (strcmp(key, "triggerable") == 0) {
+			return yes_no(value, &event->triggerable);
+		} else if (strcmp(key, "link") == 0) {
+			return number(value, &event->event_link);
+		} else if (strcmp(key, "quit") == 0) {
+			return yes_no(value, &event->quit);
+		} else if (strcmp(key, "desc") == 0) {
+			return (event->event_desc = text(value)) == NULL;
+		} else if (strcmp(key, "open") == 0) {
+			event->event_type = OPEN;
+			if (number(value, &event->event_attr1))
+				return 1;
+			if ((event->event_dir = direction(arg)) == -1) {
+				problem = "expected north, east, south or west";
+				return 1;
+			}
+			return number(arg2, &event->event_attr2);
+		} else if (strcmp(key, "break") == 0 || strcmp(key, "take") == 0 ||
+			strcmp(key, "story") == 0) {
+			event->event_type = key[0] == 'b' ? BREAK : key[0] == 't' ? TAKE : STORY;
+			return number(value, &event->event_attr1);
+		} else if (strcmp(key, "create") == 0) {
+			event->event_type = CREATE;
+			return number(value, &event->event_attr1) || number(arg, &event->event_attr2);
+		}
+	}
+	problem = record == NOTHING ? "field outside a record" : "unknown field";
+	return 1;
+
+memory:
+	problem = "out of memory";
+	return 1;
+}
+
+/* a copy of a text value with its escapes undone */
+static char *text(const char *value)
+{
+	char *copy;
+	char *p;
+
+	if ((copy = malloc(strlen(value) + 1)) == NULL) {
+		problem = "out of memory";
+		return NULL;
+	}
+	for (p = copy; *value != '\0'; value++) {
+		if (*value != '\\') {
+			*p++ = *value;
+			continue;
+		}
+		switch (*++value) {
+		case 'n':
+			*p++ = '\n';
+			break;
+		case 't':
+			*p++ = '\t';
+			break;
+		case '\\':
+			*p++ = '\\';
+			break;
+		default:
+			problem = "unknown escape in text";
+			free(copy);
+			return NULL;
+		}
+	}
+	*p = '\0';
+	return copy;
+}
+
+static int number(const char *value, int *n)
+{
+	char *end;
+	long l;
+
+	errno = 0;
+	l = strtol(value, &end, 10);
+	if (end == value || (*end != '\0' && *end != ' ' && *end != '\t') ||
+		errno != 0 || l < INT_MIN || l > INT_MAX) {
+		problem = "expected a number";
+		return 1;
+	}
+	*n = l;
+	return 0;
+}
+
+static int yes_no(const char *value, int *n)
+{
+	if (strcmp(value, "yes") == 0) {
+		*n = YES;
+	} else if (strcmp(value, "no") == 0) {
+		*n = NO;
+	} else {
+		problem = "expected yes or no";
+		return 1;
+	}
+	return 0;
+}
+
+/* the direction value starts with, or -1 */
+static int direction(const char *value)
+{
+	size_t len = strcspn(value, " \t");
+	int d;
+
+	for (d = 0; d < 4; d++)
+		if (strlen(dirs[d]) == len && strncmp(value, dirs[d], len) == 0)
+			return d;
+	return -1;
+}
+
+/* the word after the first of value, or the empty string */
+static const char *next_word(const char *value)
+{
+	value += strcspn(value, " \t");
+	return value + strspn(value, " \t");
+}
+
+/* the source of a world, which compiles back to an equivalent image */
+static int decompile(const struct world *world)
+{
+	const struct room *room;
+	const struct item *item;
+	const struct event *event;
+	int i;
+	int d;
+
+	for (i = 0; i < world->room_count; i++) {
+		room = &world->rooms[i];
+		printf("room %d\n", i);
+		put_text("name", world_string(world, room->room_name));
+		put_text("desc", world_string(world, room->room_desc));
+		for (d = 0; d < 4; d++) {
+			if (room->walk_to[d] == -1 && room->walk_desc[d] == 0)
+				continue;
+			printf("\t%s %d", dirs[d], room->walk_to[d]);
+			put_text("", world_string(world, room->walk_desc[d]));
+			if (room->walk_desc[d] == 0)
+				putchar('\n');
+		}
+		put_text("search", world_string(world, room->search_desc));
+		putchar('\n');
+	}
+	for (i = 0; i < world->item_count; i++) {
+		item = &world->items[i];
+		printf("item %d\n", i);
+		put_text("name", world_string(world, item->item_name));
+		put_text("adj", world_string(world, item->item_adj));
+		put_text("floor", world_string(world, item->item_desc_floor));
+		put_text("examine", world_string(world, item->item_desc_exam));
+		printf("\thidden %s\n", item->hidden == YES ? "yes" : "no");
+		printf("\ttakeable %s\n", item->takeable == YES ? "yes" : "no");
+		printf("\tlocation %d\n\n", item->location);
+	}
+	for (i = 0; i < world->event_count; i++) {
+		event = &world->events[i];
+		printf("event %d\n", i);
+		printf("\tuse %d", event->item1);
+		if (event->item2 != -1)
+			printf(" %d", event->item2);
+		printf("\n\troom %d\n", event->room_id);
+		printf("\ttriggerable %s\n", event->triggerable == YES ? "yes" : "no");
+		switch (event->event_type) {
+		case OPEN:
+			printf("\topen %d %s %d\n", event->event_attr1, dirs[event->event_dir], event->event_attr2);
+			break;
+		case BREAK:
+			printf("\tbreak %d\n", event->event_attr1);
+			break;
+		case CREATE:
+			printf("\tcreate %d %d\n", event->event_attr1, event->event_attr2);
+			break;
+		case STORY:
+			printf("\tstory %d\n", event->event_attr1);
+			break;
+		case TAKE:
+			printf("\ttake %d\n", event->event_attr1);
+			break;
+		}
+		if (event->event_link != -1)
+			printf("\tlink %d\n", event->event_link);
+		printf("\tquit %s\n", event->quit == YES ? "yes" : "no");
+		put_text("desc", world_string(world, event->event_desc));
+		putchar('\n');
+	}
+	return fflush(stdout) != 0;
+}
+
+/* a text field, if there is one; an empty key continues the current line */
+static void put_text(const char *key, const char *text)
+{
+	if (text == NULL)
+		return;
+	if (*key != '\0')
+		printf("\t%s", key);
+	putchar(' ');
+	for (; *text != '\0'; text++) {
+		if (*text == '\n')
+			fputs("\\n", stdout);
+		else if (*text == '\t')
+			fputs("\\t", stdout);
+		else if (*text == '\\')
+			fputs("\\\\", stdout);
+		else
+			putchar(*text);
+	}
+	putchar('\n');
+}
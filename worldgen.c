@@ -0,0 +1,609 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <unistd.h>
+#include "forest.h"
+#include "world.h"
+int main(int argc, char *argv[]);
+static void generate(void);
+static void make_rooms(void);
+static void make_items(void);
+static void make_quest(void);
+static void make_events(void);
+static struct event_desc *add_event(int item1, int item2, int room, int type);
+static int free_dir(int room);
+static int random_room(int first, int end);
+static int other_item(void);
+static char *word(unsigned n);
+static char *format(const char *format, ...);
+static int below(int n);
+static int walkthrough(FILE *out);
+static int walk(FILE *out, int (*exits)[4], int from, int to);
+static void put_source(void);
+static void put_text(const char *key, const char *text);
+static void *allocate(size_t count, size_t size);
+
+/* worldgen - make a random world that can be won, for testing at scale
+ *
+ *	worldgen [-r rooms] [-i items] [-e events] [-b branching] [-h hidden%]
+ *		[-d depth] [-s seed] [-w walkthrough] [-o image]
+ *
+ * writes the world to standard output in the format worldc reads, or as an
+ * image with -o, and with -w a script of commands that wins it.
+ *
+ * The rooms are split into regions, each a random tree in which a room
+ * leads on to at most branching others, and each region but the first is
+ * behind a closed exit from the one before. Winning takes depth keys, used
+ * one after the other: each opens the next region, where the next key
+ * lies, or once every region is open makes the next key appear, and the
+ * last one wins. The other items lie about, and the other events use them
+ * to do anything but stand in the way: they only open exits where there
+ * were none, and never touch a key. Every item is hidden with a chance of
+ * hidden%, and the same options always make the same world.
+ */
+
+static const char *dirs[4] = {"north", "east", "south", "west"};
+static const char *nouns[16] = {
+	"stone", "stick", "coin", "key", "shell", "ring", "cup", "bone",
+	"leaf", "feather", "rope", "lamp", "box", "gem", "horn", "mask",
+};
+static const char *places[8] = {
+	"clearing", "path", "grove", "hollow", "thicket", "glade", "brook", "ridge",
+};
+
+/* what to make */
+static int room_count = 100;
+static int item_count = 200;
+static int event_count = 300;
+static int branching = 3;
+static int hidden = 20;
+static int depth = 10;
+static uint64_t seed = 1;
+
+/* the world made */
+static struct room_desc *rooms;
+static struct item_desc *items;
+static struct event_desc *events;
+static int events_made;
+static int regions;
+static int *region_start;	/* the first room of each region, and the end */
+static int *gates;		/* room * 4 + dir of the exit into each region */
+static int key_step;		/* the keys are the items 0, key_step, ... */
+static int *key_rooms;		/* where each key is used */
+
+int main(int argc, char *argv[])
+{
+	struct world_source source;
+	struct world_image *image;
+	const char *script = NULL;
+	const char *output = NULL;
+	char error[200];
+	FILE *out;
+	int c;
+
+	while ((c = getopt(argc, argv, "r:i:e:b:h:d:s:w:o:")) != -1) {
+		switch (c) {
+		case 'r': room_count = atoi(optarg); break;
+		case 'i': item_count = atoi(optarg); break;
+		case 'e': event_count = atoi(optarg); break;
+		case 'b': branching = atoi(optarg); break;
+		case 'h': hidden = atoi(optarg); break;
+		case 'd': depth = atoi(optarg); break;
+		case 's': seed = strtoull(optarg, NULL, 0); break;
+		case 'w': script = optarg; break;
+		case 'o': output = optarg; break;
+		default: goto usage;
+		}
+	}
+	if (optind != argc || room_count < 1 || depth < 1 || item_count < depth ||
+		event_count < 0 || branching < 1 || branching > 3 || hidden < 0 || hidden > 100)
+		goto usage;
+
+	generate();
+	if (output == NULL) {
+		put_source();
+	} else {
+		source.rooms = rooms;
+		source.items = items;
+		source.events = events;
+		source.room_count = room_count;
+		source.item_count = item_count;
+		source.event_count = events_made;
+		if ((image = world_build(&source, error, sizeof(error))) == NULL) {
+			fprintf(stderr, "worldgen: %s\n", error);
+			return 1;
+		}
+		if (world_verify(image, image->size)) {
+			fprintf(stderr, "worldgen: built a bad image\n");
+			return 1;
+		}
+		if ((out = fopen(output, "wb")) == NULL ||
+			fwrite(image, 1, image->size, out) != image->size || fclose(out) != 0) {
+			fprintf(stderr, "worldgen: %s: %s\n", output, strerror(errno));
+			remove(output);
+			return 1;
+		}
+	}
+	if (script != NULL && ((out = fopen(script, "w")) == NULL ||
+		walkthrough(out) || fclose(out) != 0)) {
+		fprintf(stderr, "worldgen: %s: %s\n", script, strerror(errno));
+		return 1;
+	}
+	return fflush(stdout) != 0;
+
+usage:
+	fprintf(stderr, "usage: worldgen [-r rooms] [-i items] [-e events] [-b branching]\n"
+		"\t[-h hidden%%] [-d depth] [-s seed] [-w walkthrough] [-o image]\n"
+		"with at least 1 room, depth from 1 to items and branching from 1 to 3\n");
+	return 1;
+}
+
+static void generate(void)
+{
+	int k;
+
+	/* a region for the start and for each key that opens another */
+	regions = (depth - 1 < room_count - 1 ? depth - 1 : room_count - 1) + 1;
+	key_step = item_count / depth;
+	rooms = allocate(room_count, sizeof(*rooms));
+	items = allocate(item_count, sizeof(*items));
+	events = allocate(event_count + 2 * depth, sizeof(*events));
+	region_start = allocate(regions + 1, sizeof(int));
+	gates = allocate(regions, sizeof(int));
+	key_rooms = allocate(depth, sizeof(int));
+	make_rooms();
+	make_items();
+	make_quest();
+	make_events();
+
+	/* gates were -2 so nothing else would put an exit there */
+	for (k = 1; k < regions; k++)
+		rooms[gates[k] / 4].walk_to[gates[k] % 4] = -1;
+}
+
+/* a tree of rooms in each region, each region behind a gate in the last */
+static void make_rooms(void)
+{
+	int *open = allocate(room_count, sizeof(int));	/* rooms that can lead on */
+	int *children = allocate(room_count, sizeof(int));
+	int open_count;
+	int r;
+	int k;
+	int g;
+	int p;
+	int d;
+
+	for (r = 0; r < room_count; r++) {
+		rooms[r].room_id = r;
+		rooms[r].room_name = format("The %s %s", word(r), places[r % 8]);
+		rooms[r].room_desc = format("You are in the %s %s.", word(r), places[r % 8]);
+		for (d = 0; d < 4; d++)
+			rooms[r].walk_to[d] = -1;
+	}
+	for (k = 0; k <= regions; k++)
+		region_start[k] = (int)((long)room_count * k / regions);
+
+	for (k = 0; k < regions; k++) {
+		/* the way in, closed until a key opens it, and the way back */
+		if (k > 0) {
+			do
+				g = random_room(region_start[k - 1], region_start[k]);
+			while ((d = free_dir(g)) == -1);
+			gates[k] = g * 4 + d;
+			rooms[g].walk_to[d] = -2;
+			rooms[region_start[k]].walk_to[(d + 2) % 4] = g;
+		}
+
+		/* each room hangs off an earlier one that can still lead on */
+		open[0] = region_start[k];
+		open_count = 1;
+		for (r = region_start[k] + 1; r < region_start[k + 1]; r++) {
+			g = below(open_count);
+			p = open[g];
+			d = free_dir(p);
+			rooms[p].walk_to[d] = r;
+			rooms[r].walk_to[(d + 2) % 4] = p;
+			if (++children[p] == branching || free_dir(p) == -1)
+				open[g] = open[--open_count];
+			open[open_count++] = r;
+		}
+	}
+	free(open);
+	free(children);
+}
+
+/* every item has its own adjective, so "adjective name" always finds it */
+static void make_items(void)
+{
+	struct item_desc *item;
+	int i;
+
+	for (i = 0; i < item_count; i++) {
+		item = &items[i];
+		item->item_id = i;
+		item->item_name = nouns[i % 16];
+		item->item_adj = word(i);
+		item->item_desc_floor = format("There is a %s %s here.", item->item_adj, item->item_name);
+		item->item_desc_exam = format("It is a %s %s, much like any other.",
+			item->item_adj, item->item_name);
+		item->hidden = below(100) < hidden ? YES : NO;
+		item->takeable = below(5) ? YES : NO;
+		item->location = below(20) ? random_room(0, room_count) : -1;
+	}
+}
+
+/* The keys and what using them does: key k lies in region k, or appears
+ * where the key before it was used once there are no more regions.
+ */
+static void make_quest(void)
+{
+	struct event_desc *event;
+	struct item_desc *key;
+	struct item_desc *next;
+	int last = regions - 1;
+	int k;
+
+	for (k = 0; k < depth; k++) {
+		key = &items[k * key_step];
+		key->takeable = YES;
+		if (k < regions) {
+			key->location = random_room(region_start[k], region_start[k + 1]);
+		} else {
+			key->location = -1;
+			key->hidden = NO;
+		}
+	}
+	for (k = 0; k < depth; k++) {
+		key = &items[k * key_step];
+		if (k == depth - 1) {
+			key_rooms[k] = random_room(0, room_count);
+			event = add_event(k * key_step, -1, key_rooms[k], STORY);
+			event->event_attr1 = -3;
+			event->event_desc = format("The %s %s glows, and the secret of the forest is yours.",
+				key->item_adj, key->item_name);
+			break;
+		}
+		if (k + 1 < regions) {
+			key_rooms[k] = gates[k + 1] / 4;
+			event = add_event(k * key_step, -1, key_rooms[k], OPEN);
+			event->event_attr1 = key_rooms[k];
+			event->event_dir = gates[k + 1] % 4;
+			event->event_attr2 = region_start[k + 1];
+			event->event_desc = format("A way opens to the %s.", dirs[event->event_dir]);
+		} else {
+			next = &items[(k + 1) * key_step];
+			key_rooms[k] = random_room(region_start[last], region_start[last + 1]);
+			event = add_event(k * key_step, -1, key_rooms[k], CREATE);
+			event->event_attr1 = (k + 1) * key_step;
+			event->event_attr2 = key_rooms[k];
+			event->event_desc = format("A %s %s falls at your feet.", next->item_adj, next->item_name);
+		}
+		event->quit = NO;
+		event = add_event(k * key_step, -1, key_rooms[k], BREAK);
+		event->event_attr1 = k * key_step;
+		event->event_desc = format("The %s %s crumbles to dust.", key->item_adj, key->item_name);
+	}
+}
+
+/* the rest of the events, none of them using or acting on a key */
+static void make_events(void)
+{
+	struct event_desc *event;
+	const struct item_desc *item;
+	int first = events_made;
+	int item1;
+	int room;
+	int n;
+	int d;
+
+	if (item_count == depth)
+		return;
+	while (events_made < event_count) {
+		item1 = other_item();
+		item = &items[item1];
+		room = random_room(0, room_count);
+		event = add_event(item1, below(4) ? -1 : other_item(), room, STORY);
+		if ((n = below(100)) < 60) {
+			event->event_desc = format("The %s %s hums for a moment.", item->item_adj, item->item_name);
+		} else if (n < 70) {
+			event->event_type = CREATE;
+			event->event_attr1 = other_item();
+			event->event_attr2 = random_room(0, room_count);
+			event->event_desc = format("Something is not where it was.");
+		} else if (n < 78) {
+			event->event_type = TAKE;
+			event->event_attr1 = other_item();
+			event->event_desc = format("Your pockets feel heavier.");
+		} else if (n < 86) {
+			event->event_type = BREAK;
+			event->event_attr1 = item1;
+			event->event_desc = format("The %s %s breaks.", item->item_adj, item->item_name);
+		} else if (n < 97 && (d = free_dir(room)) != -1) {
+			event->event_type = OPEN;
+			event->event_attr1 = room;
+			event->event_dir = d;
+			event->event_attr2 = random_room(0, room_count);
+			event->event_desc = format("A way opens to the %s.", dirs[d]);
+		} else {
+			event->event_attr1 = -2;
+			event->event_desc = format("The %s %s bursts into flame, and so do you.",
+				item->item_adj, item->item_name);
+		}
+		event->triggerable = below(10) ? YES : NO;
+		event->quit = below(5) ? YES : NO;
+		if (below(5) == 0)
+			event->event_link = first + below(event_count - first);
+	}
+}
+
+static struct event_desc *add_event(int item1, int item2, int room, int type)
+{
+	struct event_desc *event = &events[events_made];
+
+	event->event_id = events_made++;
+	event->item1 = item1;
+	event->item2 = item2;
+	event->room_id = room;
+	event->triggerable = YES;
+	event->event_type = type;
+	event->event_attr1 = 0;
+	event->event_attr2 = -1;	/* as worldc leaves it */
+	event->event_link = -1;
+	event->quit = YES;
+	return event;
+}
+
+/* a random direction a room has no exit or gate in, or -1 */
+static int free_dir(int room)
+{
+	int start = below(4);
+	int d;
+
+	for (d = 0; d < 4; d++)
+		if (rooms[room].walk_to[(start + d) % 4] == -1)
+			return (start + d) % 4;
+	return -1;
+}
+
+static int random_room(int first, int end)
+{
+	return first + below(end - first);
+}
+
+/* any item but a key */
+static int other_item(void)
+{
+	int i;
+
+	do
+		i = below(item_count);
+	while (i % key_step == 0 && i / key_step < depth);
+	return i;
+}
+
+/* A made-up word for n: two or more syllables of a consonant and a
+ * vowel, its digits in base 64. None of the vowels is an e, so no word is
+ * one of the nouns.
+ */
+static char *word(unsigned n)
+{
+	static const char consonants[] = "bdfghklmnprstvwz";
+	static const char vowels[] = "aiou";
+	char buffer[32];
+	int len = 0;
+
+	do {
+		buffer[len++] = consonants[n % 64 / 4];
+		buffer[len++] = vowels[n % 4];
+		n /= 64;
+	} while (n > 0 || len < 4);
+	buffer[len] = '\0';
+	return format("%s", buffer);
+}
+
+static char *format(const char *format, ...)
+{
+	va_list args;
+	char *text;
+	int len;
+
+	va_start(args, format);
+	len = vsnprintf(NULL, 0, format, args);
+	va_end(args);
+	text = allocate(len + 1, 1);
+	va_start(args, format);
+	vsnprintf(text, len + 1, format, args);
+	va_end(args);
+	return text;
+}
+
+static void *allocate(size_t count, size_t size)
+{
+	void *p;
+
+	if ((p = calloc(count ? count : 1, size)) == NULL) {
+		fprintf(stderr, "worldgen: out of memory\n");
+		exit(1);
+	}
+	return p;
+}
+
+/* splitmix64, so a seed makes the same world everywhere */
+static int below(int n)
+{
+	uint64_t z = (seed += 0x9e3779b97f4a7c15ull);
+
+	z = (z ^ z >> 30) * 0xbf58476d1ce4e5b9ull;
+	z = (z ^ z >> 27) * 0x94d049bb133111ebull;
+	return (z ^ z >> 31) % n;
+}
+
+/* play the quest through: fetch each key, take it where it is used */
+static int walkthrough(FILE *out)
+{
+	int (*exits)[4] = allocate(room_count, sizeof(*exits));
+	const struct item_desc *key;
+	int room = 0;
+	int k;
+	int d;
+
+	for (k = 0; k < room_count; k++)
+		for (d = 0; d < 4; d++)
+			exits[k][d] = rooms[k].walk_to[d];
+	for (k = 0; k < depth; k++) {
+		key = &items[k * key_step];
+		if (k < regions) {
+			if (walk(out, exits, room, key->location))
+				goto lost;
+			room = key->location;
+			if (key->hidden == YES)
+				fprintf(out, "search\n");
+			else
+				fprintf(out, "take %s %s\n", key->item_adj, key->item_name);
+		}
+		if (walk(out, exits, room, key_rooms[k]))
+			goto lost;
+		room = key_rooms[k];
+		fprintf(out, "use %s %s\n", key->item_adj, key->item_name);
+
+		/* a key made here is picked up before going on */
+		if (k + 1 < regions) {
+			exits[gates[k + 1] / 4][gates[k + 1] % 4] = region_start[k + 1];
+		} else if (k + 1 < depth) {
+			key = &items[(k + 1) * key_step];
+			fprintf(out, "take %s %s\n", key->item_adj, key->item_name);
+		}
+	}
+	free(exits);
+	return ferror(out);
+
+lost:
+	free(exits);
+	fprintf(stderr, "worldgen: no way to room %d in the walkthrough\n", key_rooms[k]);
+	errno = EINVAL;
+	return 1;
+}
+
+/* the directions of a shortest way from one room to another */
+static int walk(FILE *out, int (*exits)[4], int from, int to)
+{
+	int *queue = allocate(room_count, sizeof(int));
+	int *came = allocate(room_count, sizeof(int));	/* room * 4 + dir, -1 unseen */
+	int head = 0;
+	int tail = 0;
+	int r;
+	int d;
+	int n;
+
+	for (r = 0; r < room_count; r++)
+		came[r] = -1;
+	came[from] = from * 4;
+	queue[tail++] = from;
+	while (head < tail && came[to] == -1) {
+		r = queue[head++];
+		for (d = 0; d < 4; d++) {
+			if ((n = exits[r][d]) >= 0 && came[n] == -1) {
+				came[n] = r * 4 + d;
+				queue[tail++] = n;
+			}
+		}
+	}
+	if (came[to] == -1) {
+		free(queue);
+		free(came);
+		return 1;
+	}
+
+	/* back from the end, then out in order */
+	for (n = 0, r = to; r != from; r = came[r] / 4)
+		queue[n++] = came[r] % 4;
+	while (n > 0)
+		fprintf(out, "%s\n", dirs[queue[--n]]);
+	free(queue);
+	free(came);
+	return 0;
+}
+
+/* the world in worldc's format, see worldc.c */
+static void put_source(void)
+{
+	const struct room_desc *room;
+	const struct item_desc *item;
+	const struct event_desc *event;
+	int i;
+	int d;
+
+	printf("# worldgen -r %d -i %d -e %d -b %d -h %d -d %d\n\n",
+		room_count, item_count, event_count, branching, hidden, depth);
+	for (i = 0; i < room_count; i++) {
+		room = &rooms[i];
+		printf("room %d\n", i);
+		put_text("name", room->room_name);
+		put_text("desc", room->room_desc);
+		for (d = 0; d < 4; d++)
+			if (room->walk_to[d] != -1)
+				printf("\t%s %d\n", dirs[d], room->walk_to[d]);
+		putchar('\n');
+	}
+	for (i = 0; i < item_count; i++) {
+		item = &items[i];
+		printf("item %d\n", i);
+		put_text("name", item->item_name);
+		put_text("adj", item->item_adj);
+		put_text("floor", item->item_desc_floor);
+		put_text("examine", item->item_desc_exam);
+		printf("\thidden %s\n", item->hidden == YES ? "yes" : "no");
+		printf("\ttakeable %s\n", item->takeable == YES ? "yes" : "no");
+		printf("\tlocation %d\n\n", item->location);
+	}
+	for (i = 0; i < events_made; i++) {
+		event = &events[i];
+		printf("event %d\n", i);
+		printf("\tuse %d", event->item1);
+		if (event->item2 != -1)
+			printf(" %d", event->item2);
+		printf("\n\troom %d\n", event->room_id);
+		printf("\ttriggerable %s\n", event->triggerable == YES ? "yes" : "no");
+		switch (event->event_type) {
+		case OPEN:
+			printf("\topen %d %s %d\n", event->event_attr1, dirs[event->event_dir], event->event_attr2);
+			break;
+		case BREAK:
+			printf("\tbreak %d\n", event->event_attr1);
+			break;
+		case CREATE:
+			printf("\tcreate %d %d\n", event->event_attr1, event->event_attr2);
+			break;
+		case STORY:
+			printf("\tstory %d\n", event->event_attr1);
+			break;
+		case TAKE:
+			printf("\ttake %d\n", event->event_attr1);
+			break;
+		}
+		if (event->event_link != -1)
+			printf("\tlink %d\n", event->event_link);
+		printf("\tquit %s\n", event->quit == YES ? "yes" : "no");
+		put_text("desc", event->event_desc);
+		putchar('\n');
+	}
+}
+
+/* a text field, escaped as worldc reads it */
+static void put_text(const char *key, const char *text)
+{
+	if (text == NULL)
+		return;
+	printf("\t%s ", key);
+	for (; *text != '\0'; text++) {
+		if (*text == '\n')
+			fputs("\\n", stdout);
+		else if (*text == '\\')
+			fputs("\\\\", stdout);
+		else
+			putchar(*text);
+	}
+	putchar('\n');
+}